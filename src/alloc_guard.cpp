@@ -0,0 +1,120 @@
+#include "alloc_guard.hpp"
+
+#ifdef ALLOC_GUARD
+
+#    include "log.hpp"
+
+#    include <cstddef>
+
+// Actual glibc implementations
+extern "C" void* __libc_malloc(std::size_t size);
+extern "C" void* __libc_calloc(std::size_t count, std::size_t size);
+extern "C" void* __libc_realloc(void* ptr, std::size_t size);
+extern "C" void* __libc_memalign(std::size_t alignment, std::size_t size);
+extern "C" void  __libc_free(void* ptr);
+
+// Thread locals of the executable live in the static TLS block, so touching them never calls malloc itself
+static thread_local bool        g_armed;
+static thread_local int         g_num_allocs;
+static thread_local int         g_num_frees;
+static thread_local std::size_t g_bytes;
+static thread_local void*       g_first_caller; // return address of the first heap call of the frame
+
+static inline void recordCall(std::size_t size, void* caller)
+{
+    if ( g_armed )
+    {
+        if ( not g_num_allocs and not g_num_frees )
+        {
+            g_first_caller = caller;
+        }
+        g_num_allocs++;
+        g_bytes += size;
+    }
+}
+
+extern "C" void* malloc(std::size_t size)
+{
+    recordCall(size, __builtin_return_address(0));
+    return __libc_malloc(size);
+}
+
+extern "C" void* calloc(std::size_t count, std::size_t size)
+{
+    recordCall(count * size, __builtin_return_address(0));
+    return __libc_calloc(count, size);
+}
+
+extern "C" void* realloc(void* ptr, std::size_t size)
+{
+    recordCall(size, __builtin_return_address(0));
+    return __libc_realloc(ptr, size);
+}
+
+extern "C" void* memalign(std::size_t alignment, std::size_t size)
+{
+    recordCall(size, __builtin_return_address(0));
+    return __libc_memalign(alignment, size);
+}
+
+extern "C" void* aligned_alloc(std::size_t alignment, std::size_t size)
+{
+    recordCall(size, __builtin_return_address(0));
+    return __libc_memalign(alignment, size);
+}
+
+extern "C" int posix_memalign(void** ptr, std::size_t alignment, std::size_t size)
+{
+    recordCall(size, __builtin_return_address(0));
+    *ptr = __libc_memalign(alignment, size);
+    return *ptr ? 0 : 12; // ENOMEM
+}
+
+extern "C" void free(void* ptr)
+{
+    if ( g_armed and ptr )
+    {
+        if ( not g_num_allocs and not g_num_frees )
+        {
+            g_first_caller = __builtin_return_address(0);
+        }
+        g_num_frees++;
+    }
+    __libc_free(ptr);
+}
+
+void allocGuardBegin()
+{
+    g_num_allocs = 0;
+    g_num_frees = 0;
+    g_bytes = 0;
+    g_first_caller = nullptr;
+    g_armed = true;
+}
+
+void allocGuardPause()
+{
+    g_armed = false;
+}
+
+void allocGuardResume()
+{
+    g_armed = true;
+}
+
+void allocGuardEnd(long frame)
+{
+    g_armed = false;
+    if ( frame < ALLOC_GUARD_WARMUP_FRAMES or (not g_num_allocs and not g_num_frees) )
+    {
+        return;
+    }
+    LWARN(
+      "Frame %li made %i heap allocations (%zu bytes) and %i frees. First call from %p", frame, g_num_allocs, g_bytes,
+      g_num_frees, g_first_caller);
+#    ifdef ALLOC_GUARD_TRAP
+    __builtin_trap();
+#    endif
+}
+
+#endif
@@ -0,0 +1,23 @@
+//
+//  Guard against heap usage in the steady state of the frame loop
+//  Define the ALLOC_GUARD macro to interpose malloc, calloc, realloc, free and the aligned variants (operator new and
+//  delete end up on them as well). Heap calls made by the calling thread between "begin" and "end" are counted and
+//  any frame after the warm up that made one is reported. Define also ALLOC_GUARD_TRAP to trap on it instead.
+//  Without ALLOC_GUARD these are no-ops. Only works with glibc and can not be combined with the address sanitizer
+//
+
+#pragma once
+
+const long ALLOC_GUARD_WARMUP_FRAMES = 60; // Frames allowed to allocate while caches and drivers settle
+
+#ifdef ALLOC_GUARD
+void allocGuardBegin();          // starts counting heap calls on this thread
+void allocGuardEnd(long frame); // stops counting and reports the frame if it made any heap call after the warm up
+void allocGuardPause();         // leaves out work that is expected to allocate, like loading a level
+void allocGuardResume();        // counts again, keeping what the frame counted before the pause
+#else
+inline void allocGuardBegin() {}
+inline void allocGuardEnd(long frame) {}
+inline void allocGuardPause() {}
+inline void allocGuardResume() {}
+#endif
@@ -1,31 +1,372 @@
 #include "arena.hpp"
 
-#include "cstdlib"
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <sys/mman.h>
+#include <utility>
 
-Arena::Arena(int buffer_size)
-  : m_buffer {static_cast<unsigned char*>(std::malloc(buffer_size))}
+const int ARENA_STATS_MAX_SITES = 256;
+
+struct ArenaSiteStats
+{
+    const char*  file;
+    int          line;
+    std::int64_t count;
+    std::int64_t bytes;
+};
+
+struct ArenaStats
+{
+    std::int64_t   peak_offset;
+    std::int64_t   num_allocations;
+    std::int64_t   num_overflows;
+    std::int64_t   num_marks;
+    std::int64_t   mark_time_ns;
+    std::int64_t   mark_start_ns[ARENA_MAX_MARKS];
+    std::int64_t   untracked_count; // allocations that did not fit in the sites table
+    ArenaSiteStats sites[ARENA_STATS_MAX_SITES];
+};
+
+#ifdef ARENA_STATS
+static std::int64_t timeNowNs()
+{
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+#endif
+
+// Whether transparent huge pages can be used with "madvise". They are disabled when the mode is set to "never"
+static bool transparentHugePagesAvailable()
+{
+    std::FILE* file_handle = std::fopen("/sys/kernel/mm/transparent_hugepage/enabled", "r");
+    if ( not file_handle )
+    {
+        return false;
+    }
+    char mode[64] {};
+    std::fread(mode, sizeof(char), sizeof(mode) - 1, file_handle);
+    std::fclose(file_handle);
+    return not std::strstr(mode, "[never]");
+}
+
+Arena::Arena(std::int64_t buffer_size, int flags)
+  : m_buffer {nullptr}
   , m_offset {0}
   , m_size {buffer_size}
+  , m_committed {0}
+  , m_flags {flags}
 {
+    if ( flags & ARENA_HUGE_PAGES )
+    {
+        m_size = (buffer_size + ARENA_HUGE_PAGE_SIZE - 1) & ~(ARENA_HUGE_PAGE_SIZE - 1);
+        m_commit_granularity = ARENA_HUGE_PAGE_SIZE;
+    }
+
+    if ( flags & ARENA_VIRTUAL )
+    {
+        // Only reserves the address range. Nothing is backed by physical memory until it is committed on "grow"
+        void* address = MAP_FAILED;
+        if ( flags & ARENA_HUGE_PAGES )
+        {
+            // Without MAP_NORESERVE the whole range is taken from the huge page pool up front. This fails if the pool
+            // is too small instead of faulting later when the pages are touched
+            address = mmap(nullptr, m_size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            m_backing = ARENA_BACKING_HUGETLB;
+        }
+        if ( address == MAP_FAILED and (flags & ARENA_HUGE_PAGES) )
+        {
+            // Over-reserves by a huge page and trims both ends so the range starts on a huge page boundary
+            std::int64_t padded_size = m_size + ARENA_HUGE_PAGE_SIZE;
+            address = mmap(nullptr, padded_size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+            if ( address != MAP_FAILED )
+            {
+                unsigned char* start = static_cast<unsigned char*>(address);
+                unsigned char* aligned = reinterpret_cast<unsigned char*>(
+                  (reinterpret_cast<std::uintptr_t>(start) + ARENA_HUGE_PAGE_SIZE - 1) & ~(ARENA_HUGE_PAGE_SIZE - 1));
+                if ( aligned > start )
+                {
+                    munmap(start, aligned - start);
+                }
+                munmap(aligned + m_size, start + padded_size - (aligned + m_size));
+                address = aligned;
+            }
+            m_backing = ARENA_BACKING_PAGES;
+        }
+        else if ( address == MAP_FAILED )
+        {
+            address = mmap(nullptr, m_size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+            m_backing = ARENA_BACKING_PAGES;
+        }
+        if ( address == MAP_FAILED )
+        {
+            out_of_memory("Could not reserve", m_size, errno);
+        }
+        m_buffer = static_cast<unsigned char*>(address);
+    }
+    else if ( flags & ARENA_HUGE_PAGES )
+    {
+        m_buffer = static_cast<unsigned char*>(std::aligned_alloc(ARENA_HUGE_PAGE_SIZE, m_size));
+        m_committed = m_buffer ? m_size : 0; // Without a buffer the first allocation stops on "grow"
+        m_backing = ARENA_BACKING_MALLOC;
+    }
+    else
+    {
+        m_buffer = static_cast<unsigned char*>(std::malloc(buffer_size));
+        m_committed = m_buffer ? buffer_size : 0;
+        m_backing = ARENA_BACKING_MALLOC;
+    }
+
+    // The range is huge page aligned, either from mmap or aligned_alloc, so the kernel can back it with them
+    if ( (flags & ARENA_HUGE_PAGES) and m_backing != ARENA_BACKING_HUGETLB and transparentHugePagesAvailable()
+         and madvise(m_buffer, m_size, MADV_HUGEPAGE) == 0 )
+    {
+        m_backing = ARENA_BACKING_TRANSPARENT_HUGE_PAGES;
+    }
+    if ( flags & ARENA_HUGE_PAGES )
+    {
+        LCDEBUG(ARENA, "Arena of %li bytes backed by %s", m_size, arenaBackingName(m_backing));
+    }
+
+#ifdef ARENA_STATS
+    m_stats = static_cast<ArenaStats*>(std::calloc(1, sizeof(ArenaStats)));
+#endif
 }
 
-void Arena::reset() { m_offset = 0; }
+Arena::Arena(Arena&& other)
+{
+    *this = std::move(other);
+}
+
+Arena& Arena::operator=(Arena&& other)
+{
+    if ( this != &other )
+    {
+        release();
+        m_buffer = other.m_buffer;
+        m_offset = other.m_offset;
+        m_size = other.m_size;
+        m_committed = other.m_committed;
+        m_commit_granularity = other.m_commit_granularity;
+        std::memcpy(m_marks, other.m_marks, sizeof(m_marks));
+        m_num_marks = other.m_num_marks;
+        m_flags = other.m_flags;
+        m_backing = other.m_backing;
+        m_name = other.m_name;
+        m_stats = other.m_stats;
+
+        // Leaves the other one as an empty arena
+        other.m_buffer = nullptr;
+        other.m_offset = 0;
+        other.m_size = 0;
+        other.m_committed = 0;
+        other.m_num_marks = 0;
+        other.m_backing = ARENA_BACKING_NONE;
+        other.m_stats = nullptr;
+    }
+    return *this;
+}
+
+void Arena::grow(std::int64_t required_size)
+{
+#ifdef ARENA_STATS
+    if ( m_stats and (required_size > m_size or not(m_flags & ARENA_VIRTUAL)) )
+    {
+        m_stats->num_overflows++; // Shown on the report printed before stopping
+    }
+#endif
+    if ( required_size > m_size or not(m_flags & ARENA_VIRTUAL) ) // A fixed buffer can not grow
+    {
+        out_of_memory("Not enough memory to hold", required_size, 0);
+    }
+
+    std::int64_t new_committed = (required_size + m_commit_granularity - 1) & ~(m_commit_granularity - 1);
+    if ( new_committed > m_size )
+    {
+        new_committed = m_size;
+    }
+
+    if ( mprotect(m_buffer + m_committed, new_committed - m_committed, PROT_READ | PROT_WRITE) != 0 )
+    {
+        out_of_memory("Could not commit", new_committed - m_committed, errno);
+    }
+    m_committed = new_committed;
+}
+
+// Callers write to the memory they get right away, so an arena that can not provide it stops the program in every
+// build. Written straight to stderr because logging and LASSERT are compiled out of release builds
+void Arena::out_of_memory(const char* reason, std::int64_t size, int error_code) const
+{
+    std::fprintf(stderr, "Arena '%s': %s %li bytes", m_name, reason, size);
+    std::fprintf(stderr, error_code ? ": error code %i\n" : "\n", error_code);
+    report();
+    Logger::flush();
+    Logger::dump_recorder();
+    __builtin_trap();
+}
+
+void Arena::reset()
+{
+    m_offset = 0;
+    m_num_marks = 0;
+}
 
 void Arena::set_mark()
 {
-    LASSERT(m_mark == -1, "Mark has been already set at %i, %p", m_mark, m_buffer + m_mark);
-    m_mark = m_offset;
+    LASSERT(m_num_marks < ARENA_MAX_MARKS, "Too many nested marks: %i", m_num_marks);
+    m_marks[m_num_marks] = m_offset;
+#ifdef ARENA_STATS
+    if ( m_stats )
+    {
+        m_stats->mark_start_ns[m_num_marks] = timeNowNs();
+        m_stats->num_marks++;
+    }
+#endif
+    m_num_marks++;
 }
 
 void Arena::reset_to_mark()
 {
-    LASSERT(m_mark != -1, "Mark has not been set");
-    m_offset = m_mark;
-    m_mark = -1;
+    LASSERT(m_num_marks > 0, "Mark has not been set");
+    m_num_marks--;
+    m_offset = m_marks[m_num_marks];
+#ifdef ARENA_STATS
+    if ( m_stats and m_num_marks == 0 ) // Only the outermost marks so nested ones are not counted twice
+    {
+        m_stats->mark_time_ns += timeNowNs() - m_stats->mark_start_ns[0];
+    }
+#endif
 }
 
-Arena::~Arena()
+FrameArena::FrameArena(std::int64_t buffer_size, int flags)
+  : m_arenas {{buffer_size, flags}, {buffer_size, flags}}
+{
+    m_arenas[0].set_name("frame 0");
+    m_arenas[1].set_name("frame 1");
+}
+
+void FrameArena::flip()
+{
+    m_current ^= 1;
+    m_arenas[m_current].reset();
+}
+
+void Arena::record_allocation(std::int64_t size, const char* file, int line)
+{
+    if ( not m_stats )
+    {
+        return;
+    }
+    if ( m_offset > m_stats->peak_offset )
+    {
+        m_stats->peak_offset = m_offset;
+    }
+    m_stats->num_allocations++;
+
+    // Call sites are keyed by the address of the file name literal and the line
+    std::uint64_t hash = (reinterpret_cast<std::uintptr_t>(file) >> 3) * 31 + line;
+    for ( int probe = 0; probe < ARENA_STATS_MAX_SITES; probe++ )
+    {
+        ArenaSiteStats& site = m_stats->sites[(hash + probe) % ARENA_STATS_MAX_SITES];
+        if ( not site.file )
+        {
+            site.file = file;
+            site.line = line;
+        }
+        if ( site.file == file and site.line == line )
+        {
+            site.count++;
+            site.bytes += size;
+            return;
+        }
+    }
+    m_stats->untracked_count++;
+}
+
+void Arena::report() const
+{
+    std::fprintf(
+      stderr, "Arena '%s': %li bytes in use, %li committed, %li reserved, backed by %s\n", m_name, m_offset,
+      m_committed, m_size, arenaBackingName(m_backing));
+    if ( not m_stats )
+    {
+        return;
+    }
+
+    std::fprintf(
+      stderr, "  peak %li bytes (%.1f%% of reserved), %li allocations, %li overflows\n", m_stats->peak_offset,
+      100.0 * m_stats->peak_offset / m_size, m_stats->num_allocations, m_stats->num_overflows);
+    std::fprintf(
+      stderr, "  %li marks, %.3f ms spent inside them\n", m_stats->num_marks, m_stats->mark_time_ns / 1000000.0);
+
+    ArenaSiteStats sorted[ARENA_STATS_MAX_SITES];
+    int            num_sites = 0;
+    for ( const ArenaSiteStats& site : m_stats->sites )
+    {
+        if ( site.file )
+        {
+            sorted[num_sites++] = site;
+        }
+    }
+    std::qsort(sorted, num_sites, sizeof(ArenaSiteStats), [](const void* x, const void* y) {
+        std::int64_t bytes_x = static_cast<const ArenaSiteStats*>(x)->bytes;
+        std::int64_t bytes_y = static_cast<const ArenaSiteStats*>(y)->bytes;
+        return (bytes_x < bytes_y) - (bytes_x > bytes_y);
+    });
+    for ( int idx = 0; idx < num_sites; idx++ )
+    {
+        std::fprintf(stderr, "  %10li bytes %8li calls  %s:%i\n", sorted[idx].bytes, sorted[idx].count, sorted[idx].file, sorted[idx].line);
+    }
+    if ( m_stats->untracked_count )
+    {
+        std::fprintf(stderr, "  %li allocations from untracked call sites\n", m_stats->untracked_count);
+    }
+}
+
+void Arena::release()
 {
-    std::free(m_buffer);
+    if ( not m_buffer )
+    {
+        return;
+    }
+#ifdef ARENA_STATS
+    report();
+    std::free(m_stats);
+    m_stats = nullptr;
+#endif
+    if ( m_flags & ARENA_VIRTUAL )
+    {
+        munmap(m_buffer, m_size);
+    }
+    else
+    {
+        std::free(m_buffer);
+    }
+    m_buffer = nullptr;
 }
 
+const char* arenaBackingName(ArenaBacking backing)
+{
+    switch ( backing )
+    {
+    case ARENA_BACKING_NONE:
+        return "nothing";
+    case ARENA_BACKING_MALLOC:
+        return "malloc";
+    case ARENA_BACKING_PAGES:
+        return "regular pages";
+    case ARENA_BACKING_TRANSPARENT_HUGE_PAGES:
+        return "transparent huge pages";
+    case ARENA_BACKING_HUGETLB:
+        return "explicit huge pages";
+    }
+    return "unknown";
+}
+
+Arena::~Arena()
+{
+    release();
+}
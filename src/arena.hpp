@@ -1,51 +1,174 @@
 //
 //  Simple bump allocator implementation
+//  Define the ARENA_STATS macro to record the peak usage of each arena, the allocation count and bytes per call site
+//  and the time spent between temporary marks. The numbers are reported when the arena is destroyed or on "report"
 //
 
 #pragma once
 
 #include "log.hpp"
 
+#include <cstdint>
+#include <cstring>
+
 #define KILOBYTES(value) ((value)*1024LL)
 #define MEGABYTES(value) (KILOBYTES(value)*1024LL)
 #define GIGABYTES(value) (MEGABYTES(value)*1024LL)
 #define TERABYTES(value) (GIGABYTES(value)*1024LL)
 
+const std::int64_t ARENA_COMMIT_GRANULARITY = KILOBYTES(64); // Pages are committed in chunks of this size
+const std::int64_t ARENA_HUGE_PAGE_SIZE = MEGABYTES(2);      // Size and commit granularity of huge page arenas
+const int          ARENA_MAX_MARKS = 32;                     // Maximum depth of nested temporary marks
+
+enum ArenaFlags
+{
+    ARENA_FIXED = 0,      // A single malloc'd buffer of the given size
+    ARENA_VIRTUAL = 1,    // Reserves the given size of address space and commits pages as the offset grows
+    ARENA_HUGE_PAGES = 2, // Tries explicit huge pages first, then transparent ones and falls back to regular pages
+};
+
+enum ArenaBacking // What the buffer has actually been backed with
+{
+    ARENA_BACKING_NONE,
+    ARENA_BACKING_MALLOC,
+    ARENA_BACKING_PAGES,
+    ARENA_BACKING_TRANSPARENT_HUGE_PAGES,
+    ARENA_BACKING_HUGETLB,
+};
+
+const char* arenaBackingName(ArenaBacking backing);
+
+struct ArenaStats;
+
 class Arena
 {
   public:
-    Arena(int buffer_size);
+    Arena() = default; // empty arena. Only useful as the target of a move
+    Arena(std::int64_t buffer_size, int flags = ARENA_FIXED);
+    Arena(Arena&& other);
+    Arena& operator=(Arena&& other);
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
     ~Arena();
     void reset();
     template<typename T>
-    T*   allocate(int number = 1);
-    void set_mark();      //  sets temporary mark to start making temporary allocation
-    void reset_to_mark(); // reset to last mark
+    T*   allocate(std::int64_t number = 1, const char* file = __builtin_FILE(), int line = __builtin_LINE());
+    template<typename T>
+    T*   extend( // grows an allocation in place if it is the last one. Marks set after it are moved past its end
+      T* ptr, std::int64_t number, std::int64_t new_number, const char* file = __builtin_FILE(), int line = __builtin_LINE());
+    void set_mark();      //  pushes a temporary mark to start making temporary allocation
+    void reset_to_mark(); // reset to last mark and pops it
+    void set_name(const char* name) { m_name = name; } // used to identify the arena on the reports
+    void report() const;                               // prints the usage of the arena to stderr
+    ArenaBacking backing() const { return m_backing; }
+
+  private:
+    void grow(std::int64_t required_size); // commits more pages of a virtual arena up to at least the required size
+    [[noreturn]] void out_of_memory(const char* reason, std::int64_t size, int error_code) const; // traps
+    void record_allocation(std::int64_t size, const char* file, int line);
+    void release();
+
+    unsigned char* m_buffer = nullptr;
+    std::int64_t   m_offset = 0;
+    std::int64_t   m_size = 0;      // reserved size
+    std::int64_t   m_committed = 0; // usable size. Equal to the reserved one for fixed arenas
+    std::int64_t   m_commit_granularity = ARENA_COMMIT_GRANULARITY;
+    std::int64_t   m_marks[ARENA_MAX_MARKS];
+    int            m_num_marks = 0;
+    int            m_flags = ARENA_FIXED;
+    ArenaBacking   m_backing = ARENA_BACKING_NONE;
+    const char*    m_name = "unnamed";
+    ArenaStats*    m_stats = nullptr; // only allocated when ARENA_STATS is defined
+};
+
+// Sets a mark on construction and resets the arena to it when going out of scope. Everything allocated in between
+// is released at once
+class ArenaScope
+{
+  public:
+    ArenaScope(Arena& arena) : m_arena {arena} { m_arena.set_mark(); }
+    ~ArenaScope() { m_arena.reset_to_mark(); }
+    ArenaScope(const ArenaScope&) = delete;
+    ArenaScope& operator=(const ArenaScope&) = delete;
+
+  private:
+    Arena& m_arena;
+};
+
+// Pair of arenas for transient per-frame data, flipped after every buffer swap. Data allocated during a frame stays
+// valid through the next one, while the GPU may still be consuming it, and is then released at once
+class FrameArena
+{
+  public:
+    FrameArena(std::int64_t buffer_size, int flags = ARENA_VIRTUAL);
+    Arena& current() { return m_arenas[m_current]; }
+    void   flip(); // switches to the other arena and resets it
 
   private:
-    unsigned char* m_buffer;
-    int            m_offset;
-    int            m_size;
-    int            m_mark = -1;
+    Arena m_arenas[2];
+    int   m_current = 0;
 };
 
 template<typename T>
-T* Arena::allocate(int number)
+T* Arena::allocate(std::int64_t number, const char* file, int line)
 {
-    int alignment = alignof(T);
-    int size = sizeof(T) * number;
+    std::int64_t alignment = alignof(T);
+    std::int64_t size = sizeof(T) * number;
 
-    LASSERT(((alignment & (alignment - 1)) == 0), "Alignment is not a power of two:  %i", alignment);
+    LASSERT(((alignment & (alignment - 1)) == 0), "Alignment is not a power of two:  %li", alignment);
 
     std::ptrdiff_t padding = -m_offset & (alignment - 1);
 
     m_offset += padding;
 
-    LASSERT(((m_offset + size > m_size) == 0), "Not enough memory to allocate object");
+    if ( m_offset + size > m_committed )
+    {
+        grow(m_offset + size);
+    }
 
     T* result = reinterpret_cast<T*>(&m_buffer[m_offset]);
 
     m_offset += size;
 
+#ifdef ARENA_STATS
+    record_allocation(size, file, line);
+#endif
+
+    return result;
+}
+
+template<typename T>
+T* Arena::extend(T* ptr, std::int64_t number, std::int64_t new_number, const char* file, int line)
+{
+    LASSERT(new_number >= number, "Can not shrink an allocation from %li to %li elements", number, new_number);
+
+    // Nothing has been allocated after it so we can just bump the offset
+    unsigned char* start = reinterpret_cast<unsigned char*>(ptr);
+    if ( ptr and start + sizeof(T) * number == m_buffer + m_offset )
+    {
+        std::int64_t size = sizeof(T) * (new_number - number);
+        if ( m_offset + size > m_committed )
+        {
+            grow(m_offset + size);
+        }
+        // Marks set after it was allocated are moved past its new end. Otherwise "reset_to_mark" would release the new
+        // tail and hand it out again while the allocation still uses it
+        for ( int idx = m_num_marks - 1; idx >= 0 and m_buffer + m_marks[idx] > start; idx-- )
+        {
+            m_marks[idx] = m_offset + size;
+        }
+        m_offset += size;
+#ifdef ARENA_STATS
+        record_allocation(size, file, line);
+#endif
+        return ptr;
+    }
+
+    // Copied to the end otherwise. Like any other allocation, a copy made after a mark is released with it
+    T* result = allocate<T>(new_number, file, line);
+    if ( ptr )
+    {
+        std::memcpy(result, ptr, sizeof(T) * number);
+    }
     return result;
 }
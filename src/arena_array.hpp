@@ -0,0 +1,87 @@
+//
+//  Growable array drawing its memory from an Arena
+//  Storage allocated before a mark keeps growing in place after it and outlives it. Storage first allocated, or
+//  copied, after a mark is released with it like any other allocation
+//
+
+#pragma once
+
+#include "arena.hpp"
+
+#include <type_traits>
+
+template<typename T>
+class ArenaArray
+{
+    static_assert(std::is_trivially_copyable<T>::value, "ArenaArray elements are moved around with memcpy");
+
+  public:
+    ArenaArray(Arena& arena, std::int64_t capacity = 0);
+    ArenaArray(const ArenaArray&) = delete; // copies would share the storage and both grow it
+    ArenaArray& operator=(const ArenaArray&) = delete;
+    T&           push(const T& value); // appends an element growing the storage if needed
+    void         reserve(std::int64_t capacity);
+    void         clear() { m_size = 0; }
+    std::int64_t size() const { return m_size; }
+    T*           data() { return m_data; }
+    T*           begin() { return m_data; }
+    T*           end() { return m_data + m_size; }
+    T&           operator[](std::int64_t idx);
+    const T&     operator[](std::int64_t idx) const;
+
+  private:
+    Arena&       m_arena;
+    T*           m_data;
+    std::int64_t m_size;
+    std::int64_t m_capacity;
+};
+
+template<typename T>
+ArenaArray<T>::ArenaArray(Arena& arena, std::int64_t capacity)
+  : m_arena {arena}
+  , m_data {nullptr}
+  , m_size {0}
+  , m_capacity {0}
+{
+    if ( capacity )
+    {
+        reserve(capacity);
+    }
+}
+
+template<typename T>
+void ArenaArray<T>::reserve(std::int64_t capacity)
+{
+    if ( capacity > m_capacity )
+    {
+        // Stays in place as long as nothing else has been allocated on the arena in the meantime, also across marks
+        m_data = m_arena.extend(m_data, m_capacity, capacity);
+        m_capacity = capacity;
+    }
+}
+
+template<typename T>
+T& ArenaArray<T>::push(const T& value)
+{
+    if ( m_size == m_capacity )
+    {
+        reserve(m_capacity ? 2 * m_capacity : 16);
+    }
+    m_data[m_size] = value;
+    m_size++;
+    return m_data[m_size - 1];
+}
+
+template<typename T>
+T& ArenaArray<T>::operator[](std::int64_t idx)
+{
+    LASSERT(idx >= 0 and idx < m_size, "Index %li out of bounds. Array size is %li", idx, m_size);
+    return m_data[idx];
+}
+
+template<typename T>
+const T& ArenaArray<T>::operator[](std::int64_t idx) const
+{
+    LASSERT(idx >= 0 and idx < m_size, "Index %li out of bounds. Array size is %li", idx, m_size);
+    return m_data[idx];
+}
@@ -0,0 +1,211 @@
+//
+//  Open-addressing hash map drawing its memory from an Arena
+//
+//  Keys and values are stored inline in a single slot array and probed linearly. A separate array of one byte per
+//  slot holds its state and 7 bits of the hash, so most probes that do not match never touch the slot itself.
+//  When the table grows the old arrays are left behind on the arena until it is reset
+//
+
+#pragma once
+
+#include "arena.hpp"
+
+#include <type_traits>
+
+inline std::uint64_t hashMix(std::uint64_t x)
+{
+    // Finalizer of splitmix64
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+inline std::uint64_t hashBytes(const void* data, std::int64_t size)
+{
+    // FNV-1a
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    std::uint64_t        hash = 0xcbf29ce484222325ULL;
+    for ( std::int64_t idx = 0; idx < size; idx++ )
+    {
+        hash ^= bytes[idx];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+template<typename K>
+struct ArenaHash
+{
+    std::uint64_t operator()(const K& key) const
+    {
+        if constexpr ( std::is_integral<K>::value or std::is_enum<K>::value )
+        {
+            return hashMix(static_cast<std::uint64_t>(key));
+        }
+        else if constexpr ( std::is_pointer<K>::value )
+        {
+            return hashMix(reinterpret_cast<std::uintptr_t>(key));
+        }
+        else
+        {
+            return hashBytes(&key, sizeof(K)); // Keys must not have padding bytes
+        }
+    }
+};
+
+template<typename K, typename V, typename Hash = ArenaHash<K>>
+class ArenaHashMap
+{
+    static_assert(std::is_trivially_copyable<K>::value and std::is_trivially_copyable<V>::value, "Slots are not constructed");
+
+  public:
+    ArenaHashMap(Arena& arena, std::int64_t capacity = 16);
+    V*           find(const K& key);
+    V&           insert(const K& key, const V& value); // inserts or overwrites the value of an existing key
+    bool         remove(const K& key);
+    void         clear();
+    std::int64_t size() const { return m_size; }
+
+  private:
+    enum : std::uint8_t
+    {
+        SLOT_EMPTY = 0,
+        SLOT_DELETED = 1,
+        SLOT_USED = 0x80, // The lower 7 bits store part of the hash
+    };
+
+    struct Slot
+    {
+        K key;
+        V value;
+    };
+
+    void         rehash(std::int64_t capacity);
+    std::int64_t find_index(const K& key, std::uint64_t hash) const;
+
+    Arena&        m_arena;
+    Slot*         m_slots;
+    std::uint8_t* m_states;
+    std::int64_t  m_capacity; // always a power of two
+    std::int64_t  m_size;
+    std::int64_t  m_num_used; // live plus deleted slots
+};
+
+template<typename K, typename V, typename Hash>
+ArenaHashMap<K, V, Hash>::ArenaHashMap(Arena& arena, std::int64_t capacity)
+  : m_arena {arena}
+  , m_slots {nullptr}
+  , m_states {nullptr}
+  , m_capacity {0}
+  , m_size {0}
+  , m_num_used {0}
+{
+    std::int64_t power_of_two = 8;
+    while ( power_of_two < capacity )
+    {
+        power_of_two *= 2;
+    }
+    rehash(power_of_two);
+}
+
+template<typename K, typename V, typename Hash>
+std::int64_t ArenaHashMap<K, V, Hash>::find_index(const K& key, std::uint64_t hash) const
+{
+    std::uint8_t tag = SLOT_USED | (hash & 0x7f);
+    std::int64_t mask = m_capacity - 1;
+    std::int64_t idx = (hash >> 7) & mask;
+    while ( m_states[idx] != SLOT_EMPTY )
+    {
+        if ( m_states[idx] == tag and m_slots[idx].key == key )
+        {
+            return idx;
+        }
+        idx = (idx + 1) & mask;
+    }
+    return -1;
+}
+
+template<typename K, typename V, typename Hash>
+V* ArenaHashMap<K, V, Hash>::find(const K& key)
+{
+    std::int64_t idx = find_index(key, Hash {}(key));
+    return idx >= 0 ? &m_slots[idx].value : nullptr;
+}
+
+template<typename K, typename V, typename Hash>
+V& ArenaHashMap<K, V, Hash>::insert(const K& key, const V& value)
+{
+    std::uint64_t hash = Hash {}(key);
+    std::int64_t  idx = find_index(key, hash);
+    if ( idx >= 0 )
+    {
+        m_slots[idx].value = value;
+        return m_slots[idx].value;
+    }
+
+    if ( 4 * (m_num_used + 1) > 3 * m_capacity ) // Keeps the load factor under 0.75
+    {
+        rehash(4 * (m_size + 1) > 3 * m_capacity / 2 ? 2 * m_capacity : m_capacity);
+    }
+
+    std::int64_t mask = m_capacity - 1;
+    idx = (hash >> 7) & mask;
+    while ( m_states[idx] & SLOT_USED )
+    {
+        idx = (idx + 1) & mask;
+    }
+    if ( m_states[idx] == SLOT_EMPTY )
+    {
+        m_num_used++;
+    }
+    m_states[idx] = SLOT_USED | (hash & 0x7f);
+    m_slots[idx].key = key;
+    m_slots[idx].value = value;
+    m_size++;
+    return m_slots[idx].value;
+}
+
+template<typename K, typename V, typename Hash>
+bool ArenaHashMap<K, V, Hash>::remove(const K& key)
+{
+    std::int64_t idx = find_index(key, Hash {}(key));
+    if ( idx < 0 )
+    {
+        return false;
+    }
+    m_states[idx] = SLOT_DELETED;
+    m_size--;
+    return true;
+}
+
+template<typename K, typename V, typename Hash>
+void ArenaHashMap<K, V, Hash>::clear()
+{
+    std::memset(m_states, SLOT_EMPTY, m_capacity);
+    m_size = 0;
+    m_num_used = 0;
+}
+
+template<typename K, typename V, typename Hash>
+void ArenaHashMap<K, V, Hash>::rehash(std::int64_t capacity)
+{
+    Slot*         old_slots = m_slots;
+    std::uint8_t* old_states = m_states;
+    std::int64_t  old_capacity = m_capacity;
+
+    m_slots = m_arena.allocate<Slot>(capacity);
+    m_states = m_arena.allocate<std::uint8_t>(capacity);
+    m_capacity = capacity;
+    clear();
+
+    for ( std::int64_t idx = 0; idx < old_capacity; idx++ )
+    {
+        if ( old_states[idx] & SLOT_USED )
+        {
+            insert(old_slots[idx].key, old_slots[idx].value);
+        }
+    }
+}
@@ -0,0 +1,61 @@
+//
+//  Arenas for worker threads
+//
+//  Every thread gets its own scratch arena, so no locking is needed to allocate. Results that outlive the job are
+//  built on an arena owned by the job and handed over to the consumer thread as a whole through an ArenaHandoff.
+//  Only the arena changes owner, the data itself is never copied
+//
+
+#pragma once
+
+#include "arena.hpp"
+
+#include <atomic>
+#include <utility>
+
+const std::int64_t THREAD_ARENA_SIZE = GIGABYTES(1); // Reserved address space of each thread scratch arena
+
+// Scratch arena of the calling thread. Created on first use and released when the thread exits
+inline Arena& threadArena()
+{
+    thread_local Arena arena {THREAD_ARENA_SIZE, ARENA_VIRTUAL};
+    return arena;
+}
+
+// Single slot mailbox between one producer and one consumer thread
+template<typename T>
+class ArenaHandoff
+{
+  public:
+    void publish(Arena&& arena, T* result); // producer side. The result must live on the given arena
+    bool take(Arena& arena, T*& result);    // consumer side. Returns false if nothing has been published yet
+    bool is_ready() const { return m_ready.load(std::memory_order_acquire); }
+
+  private:
+    std::atomic<bool> m_ready {false};
+    Arena             m_arena;
+    T*                m_result = nullptr;
+};
+
+template<typename T>
+void ArenaHandoff<T>::publish(Arena&& arena, T* result)
+{
+    LASSERT(not m_ready.load(std::memory_order_acquire), "Previous result has not been taken yet");
+    m_arena = std::move(arena);
+    m_result = result;
+    m_ready.store(true, std::memory_order_release);
+}
+
+template<typename T>
+bool ArenaHandoff<T>::take(Arena& arena, T*& result)
+{
+    if ( not m_ready.load(std::memory_order_acquire) )
+    {
+        return false;
+    }
+    arena = std::move(m_arena);
+    result = m_result;
+    m_result = nullptr;
+    m_ready.store(false, std::memory_order_release);
+    return true;
+}
@@ -0,0 +1,158 @@
+#include "asset_pack.hpp"
+
+#include "log.hpp"
+
+#include <cstring>
+
+static const char* assetName(const char* file_path)
+{
+    const char* slash = std::strrchr(file_path, '/');
+    return slash ? slash + 1 : file_path;
+}
+
+static std::uint64_t assetAlign(std::uint64_t offset)
+{
+    return (offset + ASSET_PACK_ALIGNMENT - 1) & ~(std::uint64_t)(ASSET_PACK_ALIGNMENT - 1);
+}
+
+StrView assetPackBuild(const char* const* file_paths, int num_files, Arena& arena, Arena& scratch)
+{
+    ArenaScope scope {scratch};
+    FileView*  files = scratch.allocate<FileView>(num_files);
+    bool       valid = true;
+    for ( int idx = 0; idx < num_files; idx++ )
+    {
+        files[idx] = fileMap(file_paths[idx]);
+        valid = valid and files[idx].data;
+        const char* name = assetName(file_paths[idx]);
+        if ( std::strlen(name) >= ASSET_NAME_SIZE )
+        {
+            LERROR("Asset name %s is longer than %i characters", name, ASSET_NAME_SIZE - 1);
+            valid = false;
+        }
+        for ( int other = 0; other < idx; other++ )
+        {
+            if ( std::strcmp(name, assetName(file_paths[other])) == 0 )
+            {
+                LERROR("%s and %s would have the same asset name", file_paths[other], file_paths[idx]);
+                valid = false;
+            }
+        }
+    }
+
+    std::uint64_t entries_offset = assetAlign(sizeof(AssetPackHeader));
+    std::uint64_t size = assetAlign(entries_offset + num_files * sizeof(AssetPackEntry));
+    for ( int idx = 0; idx < num_files; idx++ )
+    {
+        size = assetAlign(size + files[idx].size);
+    }
+
+    StrView pack {nullptr, 0};
+    if ( valid )
+    {
+        // Allocated as words so the pack can be read in place with the alignment the assets were laid out for
+        char* data = reinterpret_cast<char*>(arena.allocate<std::uint64_t>(size / sizeof(std::uint64_t)));
+        std::memset(data, 0, size); // Padding and the rest of the names are left as zeros
+
+        AssetPackHeader header;
+        std::memcpy(header.magic, ASSET_PACK_MAGIC, sizeof(header.magic));
+        header.version = ASSET_PACK_VERSION;
+        header.num_assets = num_files;
+        header.entries_offset = entries_offset;
+        std::memcpy(data, &header, sizeof(header));
+
+        AssetPackEntry* entries = reinterpret_cast<AssetPackEntry*>(data + entries_offset);
+        std::uint64_t   offset = assetAlign(entries_offset + num_files * sizeof(AssetPackEntry));
+        for ( int idx = 0; idx < num_files; idx++ )
+        {
+            std::strncpy(entries[idx].name, assetName(file_paths[idx]), ASSET_NAME_SIZE);
+            entries[idx].offset = offset;
+            entries[idx].size = files[idx].size;
+            std::memcpy(data + offset, files[idx].data, files[idx].size);
+            offset = assetAlign(offset + files[idx].size);
+        }
+        pack = {data, (std::int64_t)size};
+    }
+
+    for ( int idx = 0; idx < num_files; idx++ )
+    {
+        fileUnmap(files[idx]);
+    }
+    return pack;
+}
+
+bool assetPackCheck(StrView pack)
+{
+    if ( pack.size < (std::int64_t)sizeof(AssetPackHeader) )
+    {
+        return false;
+    }
+    AssetPackHeader header;
+    std::memcpy(&header, pack.data, sizeof(header));
+    if ( std::memcmp(header.magic, ASSET_PACK_MAGIC, sizeof(header.magic)) != 0 or
+         header.version != ASSET_PACK_VERSION )
+    {
+        return false;
+    }
+    std::uint64_t entries_end = header.entries_offset + (std::uint64_t)header.num_assets * sizeof(AssetPackEntry);
+    if ( header.entries_offset % alignof(AssetPackEntry) or entries_end > (std::uint64_t)pack.size )
+    {
+        return false;
+    }
+
+    const AssetPackEntry* entries = reinterpret_cast<const AssetPackEntry*>(pack.data + header.entries_offset);
+    for ( std::uint32_t idx = 0; idx < header.num_assets; idx++ )
+    {
+        const AssetPackEntry& entry = entries[idx];
+        if ( entry.offset % ASSET_PACK_ALIGNMENT or entry.offset > (std::uint64_t)pack.size or
+             entry.size > (std::uint64_t)pack.size - entry.offset or entry.name[ASSET_NAME_SIZE - 1] != '\0' )
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool assetPackOpen(AssetPack& pack, const char* path)
+{
+    assetPackClose(pack);
+    pack.file = fileMap(path);
+    if ( not pack.file.data )
+    {
+        return false;
+    }
+    if ( not assetPackCheck({pack.file.data, pack.file.size}) )
+    {
+        LERROR("Asset pack %s is not valid. Run \"make assets\" to rebuild it", path);
+        fileUnmap(pack.file);
+        return false;
+    }
+
+    AssetPackHeader header;
+    std::memcpy(&header, pack.file.data, sizeof(header));
+    pack.entries = reinterpret_cast<const AssetPackEntry*>(pack.file.data + header.entries_offset);
+    pack.num_assets = header.num_assets;
+    LDEBUG("Mapped %i assets from %s", pack.num_assets, path);
+    return true;
+}
+
+void assetPackClose(AssetPack& pack)
+{
+    fileUnmap(pack.file);
+    pack.entries = nullptr;
+    pack.num_assets = 0;
+}
+
+StrView assetGet(const AssetPack& pack, const char* name)
+{
+    // A pack holds a handful of assets, so a linear search is as fast as anything else
+    for ( int idx = 0; idx < pack.num_assets; idx++ )
+    {
+        if ( std::strncmp(pack.entries[idx].name, name, ASSET_NAME_SIZE) == 0 )
+        {
+            return {pack.file.data + pack.entries[idx].offset, (std::int64_t)pack.entries[idx].size};
+        }
+    }
+    LERROR("There is no asset %s in the asset pack", name);
+    return {nullptr, 0};
+}
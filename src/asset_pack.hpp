@@ -0,0 +1,55 @@
+//
+//  Asset pack: every file the game reads at startup bundled in a single file
+//
+//  tools/assetpack.cpp writes the shaders, the font, the textures and the level pack next to the executable ("make
+//  assets"). The game maps it once and hands out views into the mapping, so nothing is copied and the game does not
+//  depend on the working directory. Assets are looked up by the name of their source file without its directory.
+//
+//  Layout, all values in native byte order and offsets from the start of the file:
+//    AssetPackHeader
+//    AssetPackEntry[num_assets]
+//    the contents of each asset, starting at a multiple of ASSET_PACK_ALIGNMENT
+//
+
+#pragma once
+
+#include "arena.hpp"
+#include "file_io.hpp"
+
+#include <cstdint>
+
+const char          ASSET_PACK_MAGIC[4] = {'Y', 'A', 'S', 'T'};
+const std::uint32_t ASSET_PACK_VERSION = 1;
+const int           ASSET_PACK_ALIGNMENT = 16; // Enough for any type stored in an asset, and for SIMD loads
+const int           ASSET_NAME_SIZE = 48;
+
+struct AssetPackHeader
+{
+    char          magic[4];
+    std::uint32_t version;
+    std::uint32_t num_assets;
+    std::uint32_t entries_offset;
+};
+
+struct AssetPackEntry
+{
+    char          name[ASSET_NAME_SIZE]; // NUL-padded
+    std::uint64_t offset;
+    std::uint64_t size;
+};
+
+struct AssetPack
+{
+    FileView              file;
+    const AssetPackEntry* entries;
+    int                   num_assets;
+};
+
+// Lays out a pack with the given files on the arena. Returns an empty view if a file could not be read or two files
+// would have the same name
+StrView assetPackBuild(const char* const* file_paths, int num_files, Arena& arena, Arena& scratch);
+bool    assetPackCheck(StrView pack); // whether the header and every entry are consistent with the size
+
+bool    assetPackOpen(AssetPack& pack, const char* path);
+void    assetPackClose(AssetPack& pack);
+StrView assetGet(const AssetPack& pack, const char* name); // valid until the pack is closed. Empty if there is none
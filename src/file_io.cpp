@@ -4,11 +4,16 @@
 
 #include <cerrno>
 #include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/inotify.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <unistd.h>
 
 char* fileRead(const char* file_path, Arena& arena)
 {
-    std::FILE* file_handle = std::fopen(file_path, "r");
+    std::FILE* file_handle = std::fopen(file_path, "rb");
     if ( not file_handle )
     {
         LERROR("Could not open file %s", file_path);
@@ -19,16 +24,124 @@ char* fileRead(const char* file_path, Arena& arena)
     if ( fstat(fileno(file_handle), &sb) != 0 )
     {
         LERROR("'fstat' failed for file '%s': erro code %i", file_path, errno);
+        std::fclose(file_handle);
         return nullptr;
     }
 
-    char* string_contents = arena.allocate<char>(sb.st_size + 1);
-    std::fread(string_contents, sizeof(char), sb.st_size, file_handle);
+    char*       string_contents = arena.allocate<char>(sb.st_size + 1);
+    std::size_t count = std::fread(string_contents, sizeof(char), sb.st_size, file_handle);
+    string_contents[count] = '\0';
     std::fclose(file_handle);
 
     return string_contents;
 }
 
+FileView fileMap(const char* file_path)
+{
+    FileView view {nullptr, 0};
+    int      fd = open(file_path, O_RDONLY);
+    if ( fd < 0 )
+    {
+        LERROR("Could not open file %s", file_path);
+        return view;
+    }
+
+    struct stat sb;
+    if ( fstat(fd, &sb) != 0 )
+    {
+        LERROR("'fstat' failed for file '%s': erro code %i", file_path, errno);
+        close(fd);
+        return view;
+    }
+
+    if ( sb.st_size == 0 ) // mmap does not accept empty mappings
+    {
+        view.data = "";
+    }
+    else
+    {
+        void* data = mmap(nullptr, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if ( data == MAP_FAILED )
+        {
+            LERROR("'mmap' failed for file '%s': error code %i", file_path, errno);
+            close(fd);
+            return view;
+        }
+        madvise(data, sb.st_size, MADV_SEQUENTIAL); // Files are parsed front to back
+        view.data = static_cast<const char*>(data);
+        view.size = sb.st_size;
+    }
+    close(fd); // The mapping stays valid
+    return view;
+}
+
+void fileUnmap(FileView& view)
+{
+    if ( view.data and view.size )
+    {
+        munmap(const_cast<char*>(view.data), view.size);
+    }
+    view.data = nullptr;
+    view.size = 0;
+}
+
+bool fileWatchStart(FileWatch& watch, const char* file_path)
+{
+    fileWatchStop(watch);
+    const char* slash = std::strrchr(file_path, '/');
+    char        directory[256] = ".";
+    if ( slash )
+    {
+        if ( slash - file_path >= (std::int64_t)sizeof(directory) )
+        {
+            LERROR("Directory of %s is too long to be watched", file_path);
+            return false;
+        }
+        std::memcpy(directory, file_path, slash - file_path);
+        directory[slash - file_path] = '\0';
+    }
+    watch.name = slash ? slash + 1 : file_path;
+
+    watch.fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if ( watch.fd < 0 or inotify_add_watch(watch.fd, directory, IN_CLOSE_WRITE | IN_MOVED_TO) < 0 )
+    {
+        LERROR("Could not watch file %s: error code %i", file_path, errno);
+        fileWatchStop(watch);
+        return false;
+    }
+    return true;
+}
+
+bool fileWatchChanged(FileWatch& watch)
+{
+    if ( watch.fd < 0 )
+    {
+        return false;
+    }
+    // Several saves between two calls are reported once
+    bool changed = false;
+    alignas(inotify_event) char buffer[4096];
+    for ( ssize_t size; (size = read(watch.fd, buffer, sizeof(buffer))) > 0; )
+    {
+        for ( char* event_ptr = buffer; event_ptr < buffer + size; )
+        {
+            const inotify_event* event = reinterpret_cast<const inotify_event*>(event_ptr);
+            changed |= event->len and std::strcmp(event->name, watch.name) == 0;
+            event_ptr += sizeof(inotify_event) + event->len;
+        }
+    }
+    return changed;
+}
+
+void fileWatchStop(FileWatch& watch)
+{
+    if ( watch.fd >= 0 )
+    {
+        close(watch.fd); // Removes the watch too
+    }
+    watch.fd = -1;
+}
+
 int fileWrite(char* file_path, unsigned char* buffer, int count)
 {
     std::FILE* file_handle = std::fopen(file_path, "w");
@@ -42,48 +155,58 @@ int fileWrite(char* file_path, unsigned char* buffer, int count)
     return (int)written;
 }
 
-inline int strIsSpace(char const* str)
+StrView strNextLine(StrView& text)
 {
-    return '\0' < *str && *str <= ' ';
+    const char* end = static_cast<const char*>(std::memchr(text.data, '\n', text.size));
+    StrView     line {text.data, end ? end - text.data : text.size};
+    std::int64_t consumed = end ? line.size + 1 : line.size;
+    text.data += consumed;
+    text.size -= consumed;
+    if ( line.size and line.data[line.size - 1] == '\r' )
+    {
+        line.size--;
+    }
+    return line;
 }
 
-char* strFindFirstNonEmpty(char const* str)
+StrView strTrimLeft(StrView str)
 {
-    while ( strIsSpace(str) )
+    while ( str.size and strIsSpace(*str.data) )
     {
-        str++;
+        str.data++;
+        str.size--;
     }
-    return (char*)str;
+    return str;
 }
 
-char* strStripWhitespaceRight(const char* str, char* str_end)
+StrView strTrim(StrView str)
 {
-    str_end--;
-    while ( str_end > str && strIsSpace(str_end) )
+    str = strTrimLeft(str);
+    while ( str.size and strIsSpace(str.data[str.size - 1]) )
     {
-        *str_end = '\0';
-        str_end--;
+        str.size--;
     }
-    return (char*)str;
+    return str;
 }
 
-bool strCompare(const char* str_1, const char* str_2)
+bool strCompare(StrView str_1, const char* str_2)
 {
-    while ( *str_1 && (*str_1 == *str_2) )
+    std::int64_t idx = 0;
+    while ( idx < str_1.size and str_1.data[idx] == str_2[idx] )
     {
-        str_1++;
-        str_2++;
+        idx++;
     }
-    return *str_1 == *str_2;
+    return idx == str_1.size and str_2[idx] == '\0';
 }
 
-char* strFindCharOrCommentChar(char const* str, char schar, char comment_char)
+std::int64_t strFindCharOrCommentChar(StrView str, char schar, char comment_char)
 {
-    int was_whitespace = 0;
-    while ( *str && *str != schar && !(was_whitespace && *str == comment_char) )
+    bool         was_whitespace = false;
+    std::int64_t idx = 0;
+    while ( idx < str.size and str.data[idx] != schar and !(was_whitespace and str.data[idx] == comment_char) )
     {
-        was_whitespace = strIsSpace(str);
-        str++;
+        was_whitespace = strIsSpace(str.data[idx]);
+        idx++;
     }
-    return (char*)str;
+    return idx;
 }
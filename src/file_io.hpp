@@ -7,15 +7,44 @@
 
 #include "arena.hpp"
 
-// Reads whole text file into a buffer on the arena
+// Read-only characters that are not owned and not NUL-terminated
+struct StrView
+{
+    const char*  data;
+    std::int64_t size;
+};
+
+// Whole file mapped read-only in memory. Pages are loaded on first access and nothing is copied
+struct FileView
+{
+    const char*  data; // nullptr if the file could not be mapped
+    std::int64_t size;
+};
+
+// Reads whole text file into a NUL-terminated buffer on the arena
 char* fileRead(const char* file_path, Arena& arena);
 
+FileView fileMap(const char* file_path);
+void     fileUnmap(FileView& view);
+
+// Watches a single file for changes through its directory, so editors that replace the file on save are seen too
+struct FileWatch
+{
+    int         fd = -1;
+    const char* name; // part of the path after the directory
+};
+
+bool fileWatchStart(FileWatch& watch, const char* file_path);
+bool fileWatchChanged(FileWatch& watch); // whether the file has been written since the last call. Never blocks
+void fileWatchStop(FileWatch& watch);
+
 // Writes "count" chars of buffer into the path as a text file
-int fileWrite(char* file_path, char* buffer, int count);
-
-// String manipulation functions
-inline int strIsSpace(char const* str);
-char*      strFindFirstNonEmpty(const char* str);
-char*      strFindCharOrCommentChar(const char* str, char c, char comment_char);
-char*      strStripWhitespaceRight(const char* str, char* str_end);
-bool       strCompare(const char* str_1, const char* str_2);
+int fileWrite(char* file_path, unsigned char* buffer, int count);
+
+// String manipulation functions over views. None of them modifies the characters
+inline bool  strIsSpace(char c) { return '\0' < c and c <= ' '; }
+StrView      strNextLine(StrView& text); // pops the next line out of the text, without the line break
+StrView      strTrimLeft(StrView str);
+StrView      strTrim(StrView str);
+std::int64_t strFindCharOrCommentChar(StrView str, char c, char comment_char); // returns the size if not found
+bool         strCompare(StrView str_1, const char* str_2);
@@ -8,17 +8,21 @@
 
 unsigned char* FontLoad(FontData& font_data, Arena& arena)
 {
-    // Read the font file
-    unsigned char* file_buffer = (unsigned char*)fileRead(font_data.file_path, arena);
-    LDEBUG("Loading font %s", font_data.file_path);
+    // The font file is only needed until the glyphs are packed into the atlas
+    const unsigned char* file_buffer = reinterpret_cast<const unsigned char*>(font_data.file.data);
+    if ( not file_buffer )
+    {
+        return nullptr;
+    }
+    LCDEBUG(RENDER, "Loading font (%li bytes)", font_data.file.size);
 
     int font_count = stbtt_GetNumberOfFonts(file_buffer);
-    LDEBUG("Font file has %i fonts", font_count);
+    LCDEBUG(RENDER, "Font file has %i fonts", font_count);
 
     stbtt_fontinfo font_info = {};
     if ( !stbtt_InitFont(&font_info, file_buffer, 0) )
     {
-        LERROR("Font file %s initialization failed", font_data.file_path);
+        LCERROR(RENDER, "Font file initialization failed");
     }
 
     unsigned char* texture_data = arena.allocate<unsigned char>(font_data.atlas_width * font_data.atlas_height);
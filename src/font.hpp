@@ -1,5 +1,6 @@
 #pragma once
 #include "arena.hpp"
+#include "file_io.hpp"
 
 #include <stb/stb_truetype.h>
 
@@ -8,7 +9,7 @@ static const int FIRST_CHAR = (int)' '; // Code point of the first printable ASC
 
 struct FontData
 {
-    const char*        file_path;
+    StrView            file; // contents of the TTF file. Only read by FontLoad
     int                size;
     int                atlas_width;
     int                atlas_height;
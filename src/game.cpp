@@ -1,175 +1,96 @@
 #include "game.hpp"
 
+#include "arena_array.hpp"
 #include "file_io.hpp"
+#include "level.hpp"
 #include "log.hpp"
 
 #include <SDL2/SDL.h>
 #include <cstdio>
 #include <cstring>
+#include <unistd.h>
 
-struct LevelData
+static LevelSet    g_levels;
+static const char* g_levels_path; // given with "--levels". The levels bundled in the asset pack are played otherwise
+static FileWatch   g_levels_watch;
+
+static bool levelsFromStdin()
 {
-    char level_name[128];
-    int  tiles[LEVEL_DIM.y][LEVEL_DIM.x];
-};
+    return g_levels_path and std::strcmp(g_levels_path, "-") == 0;
+}
 
-static struct
+static bool levelsFromXsb()
 {
-    LevelData data[MAX_LEVELS];
-    int       num_levels;
-} g_levels;
+    std::size_t length = std::strlen(g_levels_path);
+    return length >= 4 and (std::strcmp(g_levels_path + length - 4, ".xsb") == 0 or
+                            std::strcmp(g_levels_path + length - 4, ".sok") == 0);
+}
 
-void LoadLevelData(Arena& arena)
+bool LoadLevelData(Arena& arena, StrView bundled_pack, const char* levels_path)
 {
-    g_levels.num_levels = 0;
-    arena.set_mark();
-    char* file_str = fileRead("assets/levels", arena);
-    char* line = std::strtok(file_str, "\n");
-
-    bool parsing_level = false;
-    bool parsing_data = false;
-    char comment_char = '#';
-    int  tile_counter = 0;
-
-    LDEBUG("Parsing file assets/levels");
-    while ( line )
+    g_levels_path = levels_path;
+    bool loaded;
+    if ( not levels_path ) // The bundled pack does not change while the game runs. There is nothing to watch
     {
-        char* ptr_start;
-        char* ptr_end;
-        ptr_start = strFindFirstNonEmpty(line);
-        if ( not parsing_level )
+        loaded = bundled_pack.data and levelPackCheck(bundled_pack);
+        if ( loaded )
         {
-            if ( *ptr_start == '[' )
-            {
-                ptr_end = strFindCharOrCommentChar(ptr_start + 1, ']', comment_char);
-                if ( *ptr_end == ']' )
-                {
-                    std::size_t count = ptr_end - ptr_start - 1;
-                    std::strncpy(g_levels.data[g_levels.num_levels].level_name, ptr_start + 1, count);
-                    g_levels.data[g_levels.num_levels].level_name[count] = '\0';
-                    parsing_level = true;
-                    LDEBUG("Parsing now level: %s", g_levels.data[g_levels.num_levels].level_name);
-                }
-            }
+            levelSetAttachPack(g_levels, bundled_pack);
         }
-        else
-        {
-            if ( not parsing_data )
-            {
-                ptr_end = strFindCharOrCommentChar(ptr_start + 1, '=', comment_char);
-                if ( *ptr_end == '=' )
-                {
-                    *ptr_end = '\0'; // separate the key and the value
-                    char* key;
-                    char* value;
-                    key = strStripWhitespaceRight(ptr_start, ptr_end);
-                    value = strFindFirstNonEmpty(ptr_end + 1);
-
-                    ptr_end = strFindCharOrCommentChar(ptr_end + 1, '\0', comment_char);
-                    if ( *ptr_end == comment_char )
-                    {
-                        *ptr_end = '\0';
-                    }
-                    value = strStripWhitespaceRight(value, ptr_end);
-                    LDEBUG("Parsing key-value property: %s : %s ", key, value);
-
-                    if ( strCompare(key, "level") )
-                    {
-                        parsing_data = true;
-                    }
-                }
-            }
-            else
-            {
-                LDEBUG("Processing line %s", line);
-                while ( *line )
-                {
-                    int tile_idx_x = tile_counter % LEVEL_DIM.x;
-                    int tile_idx_y = tile_counter / LEVEL_DIM.x;
-                    LASSERT(tile_idx_x < LEVEL_DIM.x, "Number of horizontal tiles is larger than the dimension %s", line);
-                    LASSERT(tile_idx_y < LEVEL_DIM.y, "Number of vertical tiles is larger than the dimensions: %s", line);
-                    if ( *line == '-' )
-                    {
-                        g_levels.data[g_levels.num_levels].tiles[tile_idx_y][tile_idx_x] = TT_EMPTY;
-                        tile_counter++;
-                    }
-                    else if ( *line == '1' )
-                    {
-                        g_levels.data[g_levels.num_levels].tiles[tile_idx_y][tile_idx_x] = TT_WALL;
-                        tile_counter++;
-                    }
-                    else if ( *line == 'E' )
-                    {
-                        g_levels.data[g_levels.num_levels].tiles[tile_idx_y][tile_idx_x] = TT_PLAYER;
-                        tile_counter++;
-                    }
-                    else if ( *line == 'B' )
-                    {
-                        g_levels.data[g_levels.num_levels].tiles[tile_idx_y][tile_idx_x] = TT_BOX;
-                        tile_counter++;
-                    }
-                    else if ( *line == 'O' )
-                    {
-                        g_levels.data[g_levels.num_levels].tiles[tile_idx_y][tile_idx_x] = TT_GOAL;
-                        tile_counter++;
-                    }
-                    else if ( *line == 'G' )
-                    {
-                        g_levels.data[g_levels.num_levels].tiles[tile_idx_y][tile_idx_x] = TT_OCCUPIED;
-                        tile_counter++;
-                    }
-                    line++;
-                    if ( tile_counter == LEVEL_DIM.x * LEVEL_DIM.y )
-                    {
-                        parsing_data = false;
-                        parsing_level = false;
-                        tile_counter = 0;
-                        g_levels.num_levels++;
-                        break;
-                    }
-                }
-            }
-        }
-
-        line = std::strtok(nullptr, "\n");
     }
-
-    // Corrects the type of walls
-    for ( int level = 0; level < g_levels.num_levels; level++ )
+    else if ( levelsFromStdin() ) // Text format piped in. Levels keep arriving while the game runs
     {
-        for ( int idx_y = 0; idx_y < LEVEL_DIM.y; idx_y++ )
-        {
-            for ( int idx_x = 0; idx_x < LEVEL_DIM.x; idx_x++ )
-            {
-                if ( g_levels.data[level].tiles[idx_y][idx_x] == TT_WALL )
-                {
-                    bool n = g_levels.data[level].tiles[idx_y - 1][idx_x] >= 0;
-                    bool s = g_levels.data[level].tiles[idx_y + 1][idx_x] >= 0;
-                    bool w = g_levels.data[level].tiles[idx_y][idx_x - 1] >= 0;
-                    bool e = g_levels.data[level].tiles[idx_y][idx_x + 1] >= 0;
-
-                    if ( (!n && !s && !w && !e) || (!n && !s && w && e) )
-                    {
-                        g_levels.data[level].tiles[idx_y][idx_x] = TT_WALL;
-                    }
-                    else if ( (n && s && !w && !e) || (n && s && !w && e) || (n && s && w && !e) )
-                    {
-                        g_levels.data[level].tiles[idx_y][idx_x] = TT_WALL_TRANS;
-                    }
-                    else if ( (n && !s && w && !e) || (n && !s && !w && e) || (n && !s && !w && !e) || (n && !s && w && e) )
-                    {
-                        g_levels.data[level].tiles[idx_y][idx_x] = TT_WALL_CORNER;
-                    }
-                    else if ( (!n && s && w && !e) || (!n && s && !w && e) || (!n && s && !w && !e) || (!n && s && w && e) )
-                    {
-                        g_levels.data[level].tiles[idx_y][idx_x] = TT_WALL_TRANS_END;
-                    }
-                }
-            }
-        }
+        loaded = levelSetOpenStream(g_levels, STDIN_FILENO);
+    }
+    else
+    {
+        fileWatchStart(g_levels_watch, levels_path);
+        loaded = levelsFromXsb() ? levelSetLoadXsb(g_levels, levels_path)
+                                 : levelSetLoad(g_levels, "", levels_path, arena); // Parsed, so edits can be reloaded
+    }
+    if ( not loaded or g_levels.num_levels == 0 )
+    {
+        LERROR("No level could be loaded from %s", levels_path ? levels_path : "the asset pack");
+        ReleaseLevelData();
+        return false;
     }
+    return true;
+}
+
+void ReleaseLevelData()
+{
+    fileWatchStop(g_levels_watch);
+    levelSetRelease(g_levels); // Gives stdin its flags back when the levels were streamed
+}
+
+bool LevelDataChanged()
+{
+    levelSetPollStream(g_levels); // Appending levels does not change the ones already there
+    return fileWatchChanged(g_levels_watch);
+}
+
+static std::uint64_t levelHashOrZero(int level)
+{
+    const LevelPackEntry* entry = level < g_levels.num_levels ? levelGet(g_levels, level) : nullptr;
+    return entry ? levelContentHash(*entry) : 0;
+}
 
-    arena.reset_to_mark();
+bool ReloadLevelData(Arena& arena, int level)
+{
+    if ( not g_levels_path or levelsFromStdin() ) // The bundled pack can not change and a stream can not be read again
+    {
+        return false;
+    }
+    std::uint64_t old_hash = levelHashOrZero(level);
+    if ( levelsFromXsb() ) // Only indexed on load, so there is nothing to gain from comparing the sections
+    {
+        levelSetLoadXsb(g_levels, g_levels_path);
+    }
+    else
+    {
+        levelSetReload(g_levels, g_levels_path, arena);
+    }
+    return levelHashOrZero(level) != old_hash;
 }
 
 static void addToBuffer(Renderable& renderable, const Vec4* quad, const Vec4* offsets, int num_instances)
@@ -204,15 +125,14 @@ static void addToBuffer(Renderable& renderable, const Vec4* quad, const Vec4* of
     glBindVertexArray(0);
 }
 
-static void FontAddText(const char* text, int pos_y, FontData& font_data, Registry& registry)
+// The glyph quads are built on the frame arena. They are only read until they are uploaded
+static void FontAddText(StrView text_view, int pos_y, FontData& font_data, Registry& registry, Arena& frame_arena)
 {
+    Vec4 quad_offset {};
 
-    Vec4  char_quads[4 * MAX_CHARS_PER_STRING] {};
-    Vec4* ptr_start = &char_quads[0];
-    Vec4  quad_offset {};
-
-    int pos_x {};
-    while ( *text )
+    int         pos_x {};
+    const char* text = text_view.data;
+    while ( text < text_view.data + text_view.size )
     {
         // Check if the charecter glyph is in the font atlas.
         if ( *text >= FIRST_CHAR && *text <= FIRST_CHAR + NUMBER_OF_CHARS )
@@ -223,22 +143,17 @@ static void FontAddText(const char* text, int pos_y, FontData& font_data, Regist
             int                 size_x = char_packed->x1 - char_packed->x0;
             int                 size_y = char_packed->y1 - char_packed->y0;
 
-            Vec4 quad[4] = {
-
-              {         (float)(pos_x + char_packed->xoff),          (float)(pos_y + char_packed->yoff), char_aligned->s0, char_aligned->t0},
-              {(float)(pos_x + char_packed->xoff + size_x),          (float)(pos_y + char_packed->yoff), char_aligned->s1, char_aligned->t0},
-              {(float)(pos_x + char_packed->xoff + size_x), (float)(pos_y + char_packed->yoff + size_y), char_aligned->s1, char_aligned->t1},
-              {         (float)(pos_x + char_packed->xoff), (float)(pos_y + char_packed->yoff + size_y), char_aligned->s0, char_aligned->t1}
-            };
-
-            std::memcpy(ptr_start, &quad, 4 * sizeof(Vec4));
-            ptr_start = ptr_start + 4;
+            Vec4* quad = frame_arena.allocate<Vec4>(4);
+            quad[0] = {         (float)(pos_x + char_packed->xoff),          (float)(pos_y + char_packed->yoff), char_aligned->s0, char_aligned->t0};
+            quad[1] = {(float)(pos_x + char_packed->xoff + size_x),          (float)(pos_y + char_packed->yoff), char_aligned->s1, char_aligned->t0};
+            quad[2] = {(float)(pos_x + char_packed->xoff + size_x), (float)(pos_y + char_packed->yoff + size_y), char_aligned->s1, char_aligned->t1};
+            quad[3] = {         (float)(pos_x + char_packed->xoff), (float)(pos_y + char_packed->yoff + size_y), char_aligned->s0, char_aligned->t1};
 
             pos_x += char_packed->xadvance;
             EntityID ent_id = regNewEntity(registry);
             Entity&  entity = regGetEntity(registry, ent_id);
 
-            addToBuffer(entity.renderable, &quad[0], &quad_offset, 1);
+            addToBuffer(entity.renderable, quad, &quad_offset, 1);
 
             entity.flags = ENT_FLAG_TEXT;
 
@@ -277,7 +192,7 @@ EntityID HasCollided(Registry& registry, EntityID player_ent_id, int bitmask)
     // The bitmask work to mask-"OUT", i.e., ignore, the elements that match such mask
     Entity&  player_ent = regGetEntity(registry, player_ent_id);
     SDL_Rect collider_player = {(int)player_ent.pos.x, (int)player_ent.pos.y, player_ent.size.x, player_ent.size.y};
-    for ( int idx = 0; idx < registry.num_entities; idx++ )
+    for ( int idx = 0; idx < registry.entities.size(); idx++ )
     {
         const Entity& ent = regGetEntity(registry, idx);
         if ( ent.size.x == 0 or idx == player_ent_id or ent.flags & bitmask )
@@ -298,7 +213,7 @@ bool HasWon(Registry& registry)
 
     int num_occupied = 0;
     int num_prices = 0;
-    for ( int idx = 0; idx < registry.num_entities; idx++ )
+    for ( int idx = 0; idx < registry.entities.size(); idx++ )
     {
         const Entity& entity = regGetEntity(registry, idx);
         if ( entity.flags & ENT_FLAG_GOAL )
@@ -313,43 +228,52 @@ bool HasWon(Registry& registry)
     return num_prices == num_occupied;
 }
 
+static void releaseRenderable(Renderable& renderable)
+{
+    if ( renderable.VAO )
+    {
+        glDeleteVertexArrays(1, &renderable.VAO);
+    }
+    if ( renderable.VBO )
+    {
+        glDeleteBuffers(1, &renderable.VBO);
+    }
+    if ( renderable.VBO_instance )
+    {
+        glDeleteBuffers(1, &renderable.VBO_instance);
+    }
+}
+
 void CleanUp(Registry& registry)
 {
-    for ( int idx = 0; idx < registry.num_entities; idx++ )
+    for ( Entity& entity : registry.entities )
     {
-        Entity& entity = regGetEntity(registry, idx);
-        if ( entity.renderable.VAO )
-        {
-            glDeleteVertexArrays(1, &entity.renderable.VAO);
-        }
-        if ( entity.renderable.VBO )
-        {
-            glDeleteBuffers(1, &entity.renderable.VBO);
-        }
-        if ( entity.renderable.VBO_instance )
-        {
-            glDeleteBuffers(1, &entity.renderable.VBO_instance);
-        }
+        releaseRenderable(entity.renderable);
     }
-    std::memset(&registry.entities, 0, MAX_ENTITIES * sizeof(Entity)); // Resets to zero the entire array
-    registry.num_entities = 0;
+    registry.entities.clear(); // Resets to zero the used part of the array
 }
 
 EntityID regNewEntity(Registry& registry)
 {
-    LASSERT(registry.num_entities < MAX_ENTITIES, "Max number of entities reached: %i", MAX_ENTITIES);
-    if ( registry.num_entities == 0 )
+    if ( registry.entities.size() == 0 )
     {
-        registry.num_entities++; // always add one, the zero one which will be always the "invalid entity"
+        registry.entities.alloc(); // always add one, the zero one which will be always the "invalid entity"
     }
-    int id = registry.num_entities;
-    registry.num_entities++;
+    int id = registry.entities.alloc();
+    LASSERT(id != POOL_INVALID, "Max number of entities reached: %i", MAX_ENTITIES);
     return EntityID {id};
 }
 
+void regFreeEntity(Registry& registry, EntityID id)
+{
+    LASSERT(id != ENT_INVALID_ID, "The invalid entity can not be released");
+    releaseRenderable(regGetEntity(registry, id).renderable);
+    registry.entities.free(id);
+}
+
 Entity& regGetEntity(Registry& registry, EntityID id)
 {
-    LASSERT(id < registry.num_entities, "Invalid ID %i. The ID is larger than the number of entities", id);
+    LASSERT(id < registry.entities.size(), "Invalid ID %i. The ID is larger than the number of entities", id);
     return registry.entities[id];
 }
 
@@ -373,47 +297,7 @@ void regRepositionEntity(Registry& registry, EntityID ent_id, float pos_x, float
     entity.renderable.model_mat[1][3] = entity.pos.y;
 }
 
-static bool IsLevelValid(const int level[LEVEL_DIM.y][LEVEL_DIM.x])
-{
-    int  n_players = 0;
-    int  n_boxes = 0;
-    int  n_prices = 0;
-    int* level_one_dim = (int*)level;
-    for ( int idx = 0; idx < LEVEL_DIM.x * LEVEL_DIM.y; idx++ )
-    {
-        int tile_id = level_one_dim[idx];
-        if ( tile_id == TT_PLAYER )
-        {
-            n_players++;
-        }
-        else if ( tile_id == TT_BOX )
-        {
-            n_boxes++;
-        }
-        else if ( tile_id == TT_GOAL )
-        {
-            n_prices++;
-        }
-        else if ( tile_id == TT_OCCUPIED )
-        {
-            n_prices++;
-            n_boxes++;
-        }
-    }
-    if ( n_players != 1 )
-    {
-        LERROR("Number of players is not one: %i", n_players);
-        return false;
-    }
-    if ( n_boxes != n_prices )
-    {
-        LERROR("Amount of boxes %i is different than the number of prices %i", n_boxes, n_prices);
-        return false;
-    }
-    return true;
-}
-
-EntityID LoadLevel(Registry& registry, FontData& font_data, int level)
+EntityID LoadLevel(Registry& registry, FontData& font_data, int& level, Arena& frame_arena)
 {
 
     LASSERT(g_levels.num_levels, "No level data found");
@@ -423,18 +307,23 @@ EntityID LoadLevel(Registry& registry, FontData& font_data, int level)
         level = g_levels.num_levels - 1;
     }
 
-    LASSERT(IsLevelValid(g_levels.data[level].tiles), "Level is not valid");
+    // Levels of a collection that can not be played are skipped
+    const LevelPackEntry* level_entry = levelGet(g_levels, level);
+    for ( int skipped = 1; not level_entry and skipped < g_levels.num_levels; skipped++ )
+    {
+        level = (level + 1) % g_levels.num_levels;
+        level_entry = levelGet(g_levels, level);
+    }
+    LASSERT(level_entry, "None of the %i levels can be played", g_levels.num_levels);
 
     int      texture_width = 320; // TODO: Get them from reading the texture
     int      res_width = 256;     // TODO: Get them from reading the global settings
     EntityID player_ent_id {ENT_INVALID_ID};
 
-    int* level_one_dim = (int*)(g_levels.data[level].tiles);
-    int  num_static_tiles = 0;
-    Vec4 offsets[LEVEL_DIM.x * LEVEL_DIM.y] {};
+    ArenaArray<Vec4> offsets {frame_arena}; // Released with the frame, once it has been uploaded
     for ( int idx = 0; idx < LEVEL_DIM.x * LEVEL_DIM.y; idx++ )
     {
-        int      tile_id = level_one_dim[idx];
+        int      tile_id = levelTile(*level_entry, idx);
         float    position_x = (idx * (int)TILE_SIZE) % res_width;
         float    position_y = ((idx * (int)TILE_SIZE) / res_width) * TILE_SIZE;            // NOLINT: We explicitly want integer division
         float    tile_offset_x = (tile_id * (int)TILE_SIZE) % texture_width;
@@ -443,7 +332,7 @@ EntityID LoadLevel(Registry& registry, FontData& font_data, int level)
         EntityID ent_id_2 {ENT_INVALID_ID};                                                // placeholder if on the same tile there are two
         float    layer = 0.0;
 
-        if ( level_one_dim[idx] == TT_PLAYER )
+        if ( tile_id == TT_PLAYER )
         {
             ent_id = regNewEntity(registry);
             Entity& entity = regGetEntity(registry, ent_id);
@@ -453,7 +342,7 @@ EntityID LoadLevel(Registry& registry, FontData& font_data, int level)
             entity.flags |= ENT_FLAG_PLAYER;
             layer = -0.2;
         }
-        else if ( level_one_dim[idx] == TT_BOX )
+        else if ( tile_id == TT_BOX )
         {
             ent_id = regNewEntity(registry);
             Entity& entity = regGetEntity(registry, ent_id);
@@ -463,7 +352,7 @@ EntityID LoadLevel(Registry& registry, FontData& font_data, int level)
             entity.flags |= ENT_FLAG_BOX;
             layer = -0.2;
         }
-        else if ( level_one_dim[idx] == TT_GOAL or level_one_dim[idx] == TT_OCCUPIED )
+        else if ( tile_id == TT_GOAL or tile_id == TT_OCCUPIED or tile_id == TT_PLAYER_ON_GOAL )
         {
             ent_id = regNewEntity(registry);
             Entity& entity = regGetEntity(registry, ent_id);
@@ -473,16 +362,16 @@ EntityID LoadLevel(Registry& registry, FontData& font_data, int level)
             entity.flags |= ENT_FLAG_GOAL;
             layer = -0.1;
 
-            if ( level_one_dim[idx] == TT_OCCUPIED )
+            if ( tile_id == TT_OCCUPIED or tile_id == TT_PLAYER_ON_GOAL )
             {
-                // Add box
+                // Add the box or the player on top of the goal
+                bool    is_box = tile_id == TT_OCCUPIED;
                 ent_id_2 = regNewEntity(registry);
                 Entity& entity = regGetEntity(registry, ent_id_2);
-                Vec4    quad_offset {0.f, 0.f, 112.f, 128.f};
+                Vec4    quad_offset = is_box ? Vec4 {0.f, 0.f, 112.f, 128.f} : Vec4 {0.f, 0.f, 128.f, 0.f};
                 addToBuffer(entity.renderable, &QUAD[0], &quad_offset, 1);
                 entity.renderable.num_instances = 1;
-                entity.flags |= ENT_FLAG_BOX;
-                entity.flags |= ENT_FLAG_OCCUPIED;
+                entity.flags |= is_box ? ENT_FLAG_BOX | ENT_FLAG_OCCUPIED : ENT_FLAG_PLAYER;
                 entity.pos.x = position_x;
                 entity.pos.y = position_y;
                 entity.pos_prev.x = entity.pos.x;
@@ -506,11 +395,7 @@ EntityID LoadLevel(Registry& registry, FontData& font_data, int level)
             // Generates a single entity at the end containing all background tiles
             // Additionally it generates bounding boxes entities as impenetrable blocks
             ent_id = regNewEntity(registry);
-            offsets[num_static_tiles].x = position_x;
-            offsets[num_static_tiles].y = position_y;
-            offsets[num_static_tiles].z = tile_offset_x;
-            offsets[num_static_tiles].w = tile_offset_y;
-            num_static_tiles++;
+            offsets.push({position_x, position_y, tile_offset_x, tile_offset_y});
         }
 
         if ( ent_id ) // Sets the position of all entities
@@ -540,8 +425,8 @@ EntityID LoadLevel(Registry& registry, FontData& font_data, int level)
     EntityID ent_id = regNewEntity(registry);
     Entity&  entity = regGetEntity(registry, ent_id);
 
-    addToBuffer(entity.renderable, &QUAD[0], offsets, num_static_tiles);
-    entity.renderable.num_instances = num_static_tiles;
+    addToBuffer(entity.renderable, &QUAD[0], offsets.data(), offsets.size());
+    entity.renderable.num_instances = offsets.size();
 
     // set initial position
     entity.renderable.model_mat[0][0] = 1.f;
@@ -552,9 +437,11 @@ EntityID LoadLevel(Registry& registry, FontData& font_data, int level)
     entity.pos.y = 0.f;
 
     // Put goals to the bottom of the entity vector for getting that transparency effects
+    // Slots are only reordered here, right after the level is built and before any entity has been released
+    LASSERT(registry.entities.num_live() == registry.entities.size(), "Can not sort entities with released slots");
     std::qsort(
-      &registry.entities[1],
-      registry.num_entities - 1,
+      registry.entities.data() + 1,
+      registry.entities.size() - 1,
       sizeof(Entity),
       [](const void* x, const void* y) {
           const Entity arg1 = *static_cast<const Entity*>(x);
@@ -574,7 +461,7 @@ EntityID LoadLevel(Registry& registry, FontData& font_data, int level)
           return 0;
       });
 
-    for ( EntityID id = 1; id < registry.num_entities; id++ )
+    for ( EntityID id = 1; id < registry.entities.size(); id++ )
     {
         if ( registry.entities[id].flags & ENT_FLAG_PLAYER )
         {
@@ -583,10 +470,10 @@ EntityID LoadLevel(Registry& registry, FontData& font_data, int level)
     }
 
     char level_number_string_buffer[64];
-    std::sprintf(level_number_string_buffer, "Level %i", level + 1);
+    int  level_number_length = std::sprintf(level_number_string_buffer, "Level %i", level + 1);
 
-    FontAddText(level_number_string_buffer, 5, font_data, registry);
-    FontAddText(g_levels.data[level].level_name, 11, font_data, registry);
+    FontAddText({level_number_string_buffer, level_number_length}, 5, font_data, registry, frame_arena);
+    FontAddText(levelName(g_levels, level), 11, font_data, registry, frame_arena);
 
     LASSERT(player_ent_id, "No player position was specified in the map");
     return player_ent_id;
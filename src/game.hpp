@@ -2,6 +2,8 @@
 
 #include "arena.hpp"
 #include "font.hpp"
+#include "level.hpp"
+#include "pool.hpp"
 
 #include <glad/gl.h>
 
@@ -36,9 +38,8 @@ const int   MAX_ENTITIES = 128;
 const int       MAX_CHARS_PER_STRING = 128;
 const float     TILE_SIZE = 16.f;
 const float     PIXEL_ADJ = 0.1f; // Needed for the correct texel interpolation
-constexpr IVec2 LEVEL_DIM {16, 14};
-const int       MAX_LEVELS = 50;  // Amount of horizontal x vertical blocks
-const Vec4      QUAD[4] =         // Defines a quad and the texture uv corrdinates for a particular tile size
+constexpr IVec2 LEVEL_DIM {LEVEL_WIDTH, LEVEL_HEIGHT}; // Amount of horizontal x vertical blocks
+const Vec4      QUAD[4] = // Defines a quad and the texture uv corrdinates for a particular tile size
   {
     {      0.f,       0.f,       0.f + PIXEL_ADJ,       0.f + PIXEL_ADJ},
     {TILE_SIZE,      0.0f, TILE_SIZE - PIXEL_ADJ,       0.f + PIXEL_ADJ},
@@ -53,19 +54,6 @@ const float MODEL_MAT_ID[4][4] {
   {0.f, 0.f, 0.f, 1.f}
 };
 
-enum TileType
-{
-    TT_PLAYER = -1,
-    TT_BOX = -2,
-    TT_GOAL = -3,
-    TT_OCCUPIED = -4,
-    TT_EMPTY = -20,
-    TT_WALL = 0,
-    TT_WALL_TRANS = 1,
-    TT_WALL_CORNER = 2,
-    TT_WALL_TRANS_END = 3,
-};
-
 struct Entity
 {
     Vec2        pos;
@@ -87,8 +75,7 @@ enum EntityFlags
 
 struct Registry
 {
-    Entity entities[MAX_ENTITIES];
-    int    num_entities;
+    Pool<Entity, MAX_ENTITIES> entities;
 };
 
 using EntityID = int;
@@ -96,12 +83,19 @@ using EntityID = int;
 const EntityID ENT_INVALID_ID {0};
 const Entity   ENT_INVALID {};
 EntityID       regNewEntity(Registry& registry);
+void           regFreeEntity(Registry& registry, EntityID id); // releases the entity and its GL resources
 void           regRepositionEntity(Registry& registry, EntityID id, float pos_x, float pos_y);
 void           regMoveEntity(Registry& registry, EntityID id, float delta_x, float delta_y);
 Entity&        regGetEntity(Registry& registry, EntityID id);
 
-void     LoadLevelData(Arena& arena);
-EntityID LoadLevel(Registry& registry, FontData& font_data, int level);
+// Plays the bundled pack unless a path is given: the level text, which is reloaded when saved, an XSB/SOK collection
+// or "-" to stream the text from stdin. Returns false if there is no level to play
+bool     LoadLevelData(Arena& arena, StrView bundled_pack, const char* levels_path = nullptr);
+void     ReleaseLevelData();
+bool     LevelDataChanged(); // picks up streamed levels. Returns whether the level file was saved since the last call
+bool     ReloadLevelData(Arena& arena, int level); // returns true if the given level is not the same anymore
+// The geometry of the level is built on the frame arena and only read until it is uploaded. Moves to a playable level
+EntityID LoadLevel(Registry& registry, FontData& font_data, int& level, Arena& frame_arena);
 void     Draw(GLuint program, Renderable& renderable);
 EntityID HasCollided(Registry& registry, EntityID player_ent_id, int bitmask = 0);
 bool     HasWon(Registry& registry);
@@ -0,0 +1,1482 @@
+#include "level.hpp"
+
+#include "arena_array.hpp"
+#include "arena_hash_map.hpp"
+#include "arena_thread.hpp"
+#include "log.hpp"
+#include "parallel.hpp"
+#include "scan.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <new>
+#include <strings.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// The level file is classified in chunks small enough to stay in cache while the state machine walks them
+const int          LEVEL_SCAN_CHUNK = 4096;
+const std::int64_t LEVEL_MIN_CHUNK_SIZE = KILOBYTES(256); // Smaller collections are not worth starting threads for
+const int          LEVEL_MAX_CHUNKS = 4 * PARALLEL_MAX_THREADS;
+const std::int8_t  LEVEL_NOT_A_TILE = 127;
+static const char* LEVEL_SCAN_CHARS = "\n[]=#-1EBOG"; // Structure of the file and the tile characters
+
+enum LevelScanState
+{
+    SCAN_SEEK_LEVEL, // Waiting for a "[name]" line
+    SCAN_NAME,       // Between the brackets of the name
+    SCAN_PROPERTIES, // "key = value" lines until the "level" key
+    SCAN_TILES,      // Every tile character counts until the grid is full
+};
+
+// A level as read from the text, before its walls are resolved
+struct ParsedLevel
+{
+    StrView     name;
+    std::int8_t tiles[LEVEL_HEIGHT][LEVEL_WIDTH];
+};
+
+struct LevelScan
+{
+    const char*              data;
+    ArenaArray<ParsedLevel>& levels;
+    ParsedLevel              current;
+    LevelScanState state;
+    std::int64_t   line_start;
+    std::int64_t   name_start;
+    std::int64_t   separator; // Position of the '=' of the current property line, or -1
+    bool           skip_line; // Ignores the rest of the line
+    int            tile_counter;
+    std::int8_t    tile_types[256];
+};
+
+static void levelScanEndLine(LevelScan& scan, std::int64_t idx)
+{
+    const char comment_char = '#';
+    if ( scan.state == SCAN_NAME ) // Names do not span lines
+    {
+        scan.state = SCAN_SEEK_LEVEL;
+    }
+    else if ( scan.state == SCAN_PROPERTIES and scan.separator >= 0 )
+    {
+        StrView key = strTrim({scan.data + scan.line_start, scan.separator - scan.line_start});
+        StrView value {scan.data + scan.separator + 1, idx - scan.separator - 1};
+        value = strTrim({value.data, strFindCharOrCommentChar(value, '\0', comment_char)});
+        LCTRACE(PARSER, "Parsing key-value property: %.*s : %.*s ", (int)key.size, key.data, (int)value.size, value.data);
+        if ( strCompare(key, "level") )
+        {
+            scan.state = SCAN_TILES;
+        }
+    }
+    scan.line_start = idx + 1;
+    scan.separator = -1;
+    scan.skip_line = false;
+}
+
+static void levelScanChar(LevelScan& scan, std::int64_t idx)
+{
+    char c = scan.data[idx];
+    // Comments start with a '#' at the beginning of a line or after whitespace
+    bool comment = c == '#' and (idx == scan.line_start or strIsSpace(scan.data[idx - 1]));
+    switch ( scan.state )
+    {
+    case SCAN_SEEK_LEVEL:
+        if ( c == '[' and strTrimLeft({scan.data + scan.line_start, idx - scan.line_start}).size == 0 )
+        {
+            scan.state = SCAN_NAME;
+            scan.name_start = idx + 1;
+        }
+        else
+        {
+            scan.skip_line = true;
+        }
+        break;
+    case SCAN_NAME:
+        if ( c == ']' )
+        {
+            scan.current.name = {scan.data + scan.name_start, idx - scan.name_start};
+            LCDEBUG(PARSER, "Parsing now level: %.*s", (int)scan.current.name.size, scan.current.name.data);
+            scan.state = SCAN_PROPERTIES;
+            scan.skip_line = true;
+        }
+        else if ( comment )
+        {
+            scan.state = SCAN_SEEK_LEVEL;
+            scan.skip_line = true;
+        }
+        break;
+    case SCAN_PROPERTIES:
+        if ( c == '=' and scan.separator < 0 )
+        {
+            scan.separator = idx;
+        }
+        else if ( comment and scan.separator < 0 )
+        {
+            scan.skip_line = true;
+        }
+        break;
+    case SCAN_TILES:
+    {
+        std::int8_t type = scan.tile_types[static_cast<unsigned char>(c)];
+        if ( type != LEVEL_NOT_A_TILE )
+        {
+            int tile_idx_x = scan.tile_counter % LEVEL_WIDTH;
+            int tile_idx_y = scan.tile_counter / LEVEL_WIDTH;
+            scan.current.tiles[tile_idx_y][tile_idx_x] = type;
+            scan.tile_counter++;
+            if ( scan.tile_counter == LEVEL_WIDTH * LEVEL_HEIGHT )
+            {
+                scan.levels.push(scan.current);
+                scan.state = SCAN_SEEK_LEVEL;
+                scan.skip_line = true;
+                scan.tile_counter = 0;
+            }
+        }
+        break;
+    }
+    }
+}
+
+static void levelScanInit(LevelScan& scan)
+{
+    std::memset(scan.tile_types, LEVEL_NOT_A_TILE, sizeof(scan.tile_types));
+    scan.tile_types['-'] = TT_EMPTY;
+    scan.tile_types['1'] = TT_WALL;
+    scan.tile_types['E'] = TT_PLAYER;
+    scan.tile_types['B'] = TT_BOX;
+    scan.tile_types['O'] = TT_GOAL;
+    scan.tile_types['G'] = TT_OCCUPIED;
+}
+
+// Scans the characters in [start, end) of the data. The state carries over to the next call
+static void levelScanFeed(LevelScan& scan, std::int64_t start, std::int64_t end)
+{
+    static const ScanSet scan_set = scanSet(LEVEL_SCAN_CHARS);
+    for ( std::int64_t chunk_start = start; chunk_start < end; chunk_start += LEVEL_SCAN_CHUNK )
+    {
+        std::uint64_t masks[LEVEL_SCAN_CHUNK / SCAN_BLOCK_SIZE];
+        std::int64_t  chunk_size = std::min<std::int64_t>(LEVEL_SCAN_CHUNK, end - chunk_start);
+        scanClassify(scan.data + chunk_start, chunk_size, scan_set, masks);
+        for ( std::int64_t block = 0; block * SCAN_BLOCK_SIZE < chunk_size; block++ )
+        {
+            std::uint64_t mask = masks[block];
+            while ( mask )
+            {
+                std::int64_t idx = chunk_start + block * SCAN_BLOCK_SIZE + __builtin_ctzll(mask);
+                mask &= mask - 1;
+                if ( scan.data[idx] == '\n' )
+                {
+                    levelScanEndLine(scan, idx);
+                }
+                else if ( not scan.skip_line )
+                {
+                    levelScanChar(scan, idx);
+                }
+            }
+        }
+    }
+}
+
+static void levelScanText(StrView text, ArenaArray<ParsedLevel>& levels)
+{
+    LevelScan scan {text.data, levels, {}, SCAN_SEEK_LEVEL, 0, 0, -1, false, 0, {}};
+    levelScanInit(scan);
+    levelScanFeed(scan, 0, text.size);
+    levelScanEndLine(scan, text.size); // The last line might not end with a line break
+}
+
+static void levelResolveWalls(std::int8_t tiles[LEVEL_HEIGHT][LEVEL_WIDTH])
+{
+    auto is_wall = [&](int idx_y, int idx_x) {
+        return idx_y >= 0 and idx_y < LEVEL_HEIGHT and idx_x >= 0 and idx_x < LEVEL_WIDTH and tiles[idx_y][idx_x] >= 0;
+    };
+    for ( int idx_y = 0; idx_y < LEVEL_HEIGHT; idx_y++ )
+    {
+        for ( int idx_x = 0; idx_x < LEVEL_WIDTH; idx_x++ )
+        {
+            if ( tiles[idx_y][idx_x] == TT_WALL )
+            {
+                bool n = is_wall(idx_y - 1, idx_x);
+                bool s = is_wall(idx_y + 1, idx_x);
+                bool w = is_wall(idx_y, idx_x - 1);
+                bool e = is_wall(idx_y, idx_x + 1);
+
+                if ( (!n && !s && !w && !e) || (!n && !s && w && e) )
+                {
+                    tiles[idx_y][idx_x] = TT_WALL;
+                }
+                else if ( (n && s && !w && !e) || (n && s && !w && e) || (n && s && w && !e) )
+                {
+                    tiles[idx_y][idx_x] = TT_WALL_TRANS;
+                }
+                else if ( (n && !s && w && !e) || (n && !s && !w && e) || (n && !s && !w && !e) || (n && !s && w && e) )
+                {
+                    tiles[idx_y][idx_x] = TT_WALL_CORNER;
+                }
+                else if ( (!n && s && w && !e) || (!n && s && !w && e) || (!n && s && !w && !e) || (!n && s && w && e) )
+                {
+                    tiles[idx_y][idx_x] = TT_WALL_TRANS_END;
+                }
+            }
+        }
+    }
+}
+
+static std::uint8_t levelCell(int tile_id)
+{
+    for ( std::uint8_t cell = 0; cell < 16; cell++ )
+    {
+        if ( LEVEL_CELL_TILES[cell] == tile_id )
+        {
+            return cell;
+        }
+    }
+    LASSERT(false, "Tile type %i has no cell value", tile_id);
+    return 0;
+}
+
+// Fills everything but the name and the position offset. Returns false if the level can not be played
+static bool levelFillEntry(const ParsedLevel& parsed, LevelPackEntry& entry)
+{
+    std::int8_t tiles[LEVEL_HEIGHT][LEVEL_WIDTH];
+    std::memcpy(tiles, parsed.tiles, sizeof(tiles));
+    levelResolveWalls(tiles);
+
+    int num_players = 0;
+    entry.num_boxes = 0;
+    entry.num_goals = 0;
+    std::memset(entry.cells, 0, sizeof(entry.cells));
+    for ( int idx_y = 0; idx_y < LEVEL_HEIGHT; idx_y++ )
+    {
+        for ( int idx_x = 0; idx_x < LEVEL_WIDTH; idx_x++ )
+        {
+            int tile_id = tiles[idx_y][idx_x];
+            int idx = idx_y * LEVEL_WIDTH + idx_x;
+            entry.cells[idx / 2] |= levelCell(tile_id) << (4 * (idx % 2));
+            if ( tile_id == TT_PLAYER or tile_id == TT_PLAYER_ON_GOAL )
+            {
+                entry.player = {(std::uint8_t)idx_x, (std::uint8_t)idx_y};
+                num_players++;
+            }
+            entry.num_boxes += tile_id == TT_BOX or tile_id == TT_OCCUPIED;
+            entry.num_goals += tile_id == TT_GOAL or tile_id == TT_OCCUPIED or tile_id == TT_PLAYER_ON_GOAL;
+        }
+    }
+    if ( num_players != 1 )
+    {
+        LCERROR(PARSER, "Level %.*s: number of players is not one: %i", (int)parsed.name.size, parsed.name.data, num_players);
+        return false;
+    }
+    if ( entry.num_boxes != entry.num_goals )
+    {
+        LCERROR(
+          PARSER,
+          "Level %.*s: amount of boxes %i is different than the number of goals %i",
+          (int)parsed.name.size,
+          parsed.name.data,
+          entry.num_boxes,
+          entry.num_goals);
+        return false;
+    }
+    return true;
+}
+
+// Writes the boxes followed by the goals
+static void levelWritePositions(const LevelPackEntry& entry, LevelPosition* positions)
+{
+    LevelPosition* boxes = positions;
+    LevelPosition* goals = positions + entry.num_boxes;
+    for ( int idx_y = 0; idx_y < LEVEL_HEIGHT; idx_y++ )
+    {
+        for ( int idx_x = 0; idx_x < LEVEL_WIDTH; idx_x++ )
+        {
+            int           tile_id = levelTile(entry, idx_y * LEVEL_WIDTH + idx_x);
+            LevelPosition position {(std::uint8_t)idx_x, (std::uint8_t)idx_y};
+            if ( tile_id == TT_BOX or tile_id == TT_OCCUPIED )
+            {
+                *boxes++ = position;
+            }
+            if ( tile_id == TT_GOAL or tile_id == TT_OCCUPIED or tile_id == TT_PLAYER_ON_GOAL )
+            {
+                *goals++ = position;
+            }
+        }
+    }
+}
+
+// Bytes per level of the metadata columns of a pack
+const std::int64_t LEVEL_META_COLUMNS_SIZE = 3 * sizeof(std::uint16_t) + 2 * sizeof(std::uint8_t);
+
+static LevelMetaTable levelMetaColumns(const char* columns, int num_levels)
+{
+    LevelMetaTable table;
+    table.num_boxes = reinterpret_cast<const std::uint16_t*>(columns);
+    table.floor_area = table.num_boxes + num_levels;
+    table.difficulty = table.floor_area + num_levels;
+    table.width = reinterpret_cast<const std::uint8_t*>(table.difficulty + num_levels);
+    table.height = table.width + num_levels;
+    table.num_levels = num_levels;
+    return table;
+}
+
+// Same layout as levelMetaColumns
+static void levelWriteMetaColumns(const LevelMeta* meta, std::int64_t num_levels, char* columns)
+{
+    std::uint16_t* num_boxes = reinterpret_cast<std::uint16_t*>(columns);
+    std::uint16_t* floor_area = num_boxes + num_levels;
+    std::uint16_t* difficulty = floor_area + num_levels;
+    std::uint8_t*  width = reinterpret_cast<std::uint8_t*>(difficulty + num_levels);
+    std::uint8_t*  height = width + num_levels;
+    for ( std::int64_t level = 0; level < num_levels; level++ )
+    {
+        num_boxes[level] = meta[level].num_boxes;
+        floor_area[level] = meta[level].floor_area;
+        difficulty[level] = meta[level].difficulty;
+        width[level] = meta[level].width;
+        height[level] = meta[level].height;
+    }
+}
+
+static LevelMeta levelMetaRow(const LevelMetaTable& table, int level)
+{
+    return {table.width[level], table.height[level], table.num_boxes[level], table.floor_area[level], table.difficulty[level]};
+}
+
+// Valid levels of a run of sections of the text, with their names. Entries are missing the name and position offsets
+struct LevelChunkResult
+{
+    const LevelPackEntry* entries;
+    const StrView*        names;
+    const std::uint64_t*  hashes; // canonical hash of each level
+    const LevelMeta*      meta;
+    std::int64_t          num_levels;
+    const std::int32_t*   section_levels; // number of valid levels of each section of the run
+    int                   num_sections;
+    int                   num_invalid;
+};
+
+// A section is a "[" line and everything up to the next one. Whatever comes before the first "[" line is a section
+// without levels, so the sections cover the whole text
+static void levelFindSections(StrView text, ArenaArray<std::int64_t>& section_ends)
+{
+    const char* end = text.data + text.size;
+    for ( const char* line = text.data; (line = static_cast<const char*>(std::memchr(line, '\n', end - line))); )
+    {
+        line++;
+        if ( line < end and *line == '[' )
+        {
+            section_ends.push(line - text.data);
+        }
+    }
+    section_ends.push(text.size);
+}
+
+static void levelHashSections(StrView text, const std::int64_t* section_ends, int num_sections, LevelTextSection* sections)
+{
+    parallelFor(num_sections, [&](int section) {
+        std::int64_t start = section ? section_ends[section - 1] : 0;
+        sections[section].hash = hashBytes(text.data + start, section_ends[section] - start);
+    });
+}
+
+static LevelChunkResult* levelBuildChunk(
+  StrView text, const std::int64_t* section_ends, int first_section, int num_sections, Arena& arena, Arena& scratch)
+{
+    std::int64_t            start = first_section ? section_ends[first_section - 1] : 0;
+    std::int64_t            end = section_ends[first_section + num_sections - 1];
+    ArenaScope              scope {scratch};
+    ArenaArray<ParsedLevel> parsed {scratch};
+    levelScanText({text.data + start, end - start}, parsed);
+
+    LevelChunkResult* result = arena.allocate<LevelChunkResult>();
+    LevelPackEntry*   entries = arena.allocate<LevelPackEntry>(parsed.size());
+    StrView*          names = arena.allocate<StrView>(parsed.size());
+    std::uint64_t*    hashes = arena.allocate<std::uint64_t>(parsed.size());
+    LevelMeta*        meta = arena.allocate<LevelMeta>(parsed.size());
+    std::int32_t*     section_levels = arena.allocate<std::int32_t>(num_sections);
+    std::memset(section_levels, 0, num_sections * sizeof(std::int32_t));
+    *result = {entries, names, hashes, meta, 0, section_levels, num_sections, 0};
+    int section = 0;
+    for ( const ParsedLevel& level : parsed )
+    {
+        LevelPackEntry& entry = entries[result->num_levels];
+        entry = {};
+        if ( not levelFillEntry(level, entry) )
+        {
+            result->num_invalid++;
+            continue;
+        }
+        while ( level.name.data - text.data >= section_ends[first_section + section] ) // The name is in its section
+        {
+            section++;
+        }
+        section_levels[section]++;
+        hashes[result->num_levels] = levelCanonicalHash(entry);
+        meta[result->num_levels] = levelComputeMeta(entry);
+        names[result->num_levels++] = level.name;
+    }
+    return result;
+}
+
+// Lays out the pack from the results of consecutive runs of sections. The section table, if given, gets the levels
+// of each section
+static StrView levelPackMerge(
+  LevelChunkResult* const* results, int num_results, Arena& arena, Arena& scratch, LevelTextSection* sections)
+{
+    ArenaScope   scope {scratch};
+    std::int64_t num_levels = 0;
+    for ( int idx = 0; idx < num_results; idx++ )
+    {
+        num_levels += results[idx]->num_levels;
+    }
+    ArenaArray<LevelPackEntry>                entries {scratch, num_levels};
+    ArenaArray<StrView>                       sources {scratch, num_levels};
+    ArenaArray<std::uint64_t>                 level_hashes {scratch, num_levels};
+    ArenaArray<LevelMeta>                     level_meta {scratch, num_levels};
+    ArenaHashMap<std::uint64_t, std::int64_t> names_seen {scratch, num_levels}; // hash of a name to its first entry
+    std::int64_t                              num_positions = 0;
+    std::int64_t                              names_size = 0;
+    int                                       section = 0;
+    for ( int idx = 0; idx < num_results; idx++ )
+    {
+        const LevelChunkResult& result = *results[idx];
+        std::int64_t            first_level = entries.size();
+        for ( int idx_section = 0; sections and idx_section < result.num_sections; idx_section++ )
+        {
+            sections[section].first_level = first_level;
+            sections[section].num_levels = result.section_levels[idx_section];
+            first_level += sections[section].num_levels;
+            section++;
+        }
+        for ( std::int64_t level = 0; level < result.num_levels; level++ )
+        {
+            LevelPackEntry entry = result.entries[level];
+            StrView        name = result.names[level];
+            entry.first_position = num_positions;
+            entry.name_length = std::min<std::int64_t>(name.size, UINT16_MAX);
+            num_positions += entry.num_boxes + entry.num_goals;
+
+            // Names are interned. On a hash collision with a different name the new one is simply stored again
+            std::uint64_t hash = hashBytes(name.data, entry.name_length);
+            std::int64_t* first = names_seen.find(hash);
+            if ( first and entries[*first].name_length == entry.name_length and
+                 std::memcmp(sources[*first].data, name.data, entry.name_length) == 0 )
+            {
+                entry.name_offset = entries[*first].name_offset;
+            }
+            else
+            {
+                entry.name_offset = names_size;
+                names_size += entry.name_length;
+                if ( not first )
+                {
+                    names_seen.insert(hash, entries.size());
+                }
+            }
+            entries.push(entry);
+            sources.push(name);
+            level_hashes.push(result.hashes[level]);
+            level_meta.push(result.meta[level]);
+        }
+    }
+
+    // Offsets are computed in 64 bits, so a pack that is too big is caught before they are truncated
+    std::int64_t hashes_offset = sizeof(LevelPackHeader);
+    std::int64_t meta_offset = hashes_offset + entries.size() * sizeof(std::uint64_t);
+    std::int64_t levels_offset = meta_offset + entries.size() * LEVEL_META_COLUMNS_SIZE; // Stays 8-byte aligned
+    std::int64_t positions_offset = levels_offset + entries.size() * sizeof(LevelPackEntry);
+    std::int64_t names_offset = positions_offset + num_positions * sizeof(LevelPosition);
+    std::int64_t pack_size = names_offset + names_size;
+    if ( pack_size > UINT32_MAX )
+    {
+        LCERROR(PARSER, "Level pack of %li bytes does not fit the 32-bit offsets", pack_size);
+        return {nullptr, 0};
+    }
+
+    LevelPackHeader header {};
+    std::memcpy(header.magic, LEVEL_PACK_MAGIC, sizeof(header.magic));
+    header.version = LEVEL_PACK_VERSION;
+    header.num_levels = entries.size();
+    header.hashes_offset = hashes_offset;
+    header.meta_offset = meta_offset;
+    header.levels_offset = levels_offset;
+    header.positions_offset = positions_offset;
+    header.num_positions = num_positions;
+    header.names_offset = names_offset;
+    header.names_size = names_size;
+
+    // Allocated as words so the hashes are aligned
+    char* pack = reinterpret_cast<char*>(arena.allocate<std::uint64_t>((pack_size + 7) / 8));
+    std::memcpy(pack, &header, sizeof(header));
+    if ( entries.size() ) // An empty array has no storage yet
+    {
+        std::memcpy(pack + header.hashes_offset, level_hashes.data(), entries.size() * sizeof(std::uint64_t));
+        std::memcpy(pack + header.levels_offset, entries.data(), entries.size() * sizeof(LevelPackEntry));
+    }
+    LevelPosition* positions = reinterpret_cast<LevelPosition*>(pack + header.positions_offset);
+    char*          names = pack + header.names_offset;
+    for ( std::int64_t level = 0; level < entries.size(); level++ )
+    {
+        const LevelPackEntry& entry = entries[level];
+        levelWritePositions(entry, positions + entry.first_position);
+        std::memcpy(names + entry.name_offset, sources[level].data, entry.name_length);
+    }
+    levelWriteMetaColumns(level_meta.data(), entries.size(), pack + header.meta_offset);
+    return {pack, pack_size};
+}
+
+static StrView levelPackBuildSections(
+  StrView             text,
+  const std::int64_t* section_ends,
+  int                 num_sections,
+  Arena&              arena,
+  Arena&              scratch,
+  int&                num_invalid,
+  LevelTextSection*   sections)
+{
+    LASSERT(&arena != &scratch, "The pack would be released together with the scratch data");
+    ArenaScope scope {scratch};
+
+    // Big collections are parsed in parallel, in chunks of whole sections. Every thread takes a few chunks so uneven
+    // ones still balance out
+    int          num_threads = parallelNumThreads();
+    int          max_chunks = num_threads > 1 ? std::clamp<std::int64_t>(text.size / LEVEL_MIN_CHUNK_SIZE, 1, 4 * num_threads) : 1;
+    std::int64_t chunk_size = text.size / std::min(max_chunks, LEVEL_MAX_CHUNKS) + 1;
+    int          first_sections[LEVEL_MAX_CHUNKS];
+    int          chunk_sections[LEVEL_MAX_CHUNKS];
+    int          num_chunks = 0;
+    for ( int section = 0; section < num_sections; num_chunks++ )
+    {
+        std::int64_t start = section ? section_ends[section - 1] : 0;
+        first_sections[num_chunks] = section;
+        do
+        {
+            section++;
+        } while ( section < num_sections and section_ends[section - 1] - start < chunk_size );
+        chunk_sections[num_chunks] = section - first_sections[num_chunks];
+    }
+
+    Arena             chunk_arenas[LEVEL_MAX_CHUNKS];
+    LevelChunkResult* results[LEVEL_MAX_CHUNKS];
+    if ( num_chunks == 1 )
+    {
+        results[0] = levelBuildChunk(text, section_ends, 0, num_sections, scratch, threadArena());
+    }
+    else
+    {
+        ArenaHandoff<LevelChunkResult> handoffs[LEVEL_MAX_CHUNKS];
+        parallelFor(num_chunks, [&](int chunk) {
+            Arena result_arena {GIGABYTES(1), ARENA_VIRTUAL};
+            result_arena.set_name("level chunk");
+            LevelChunkResult* result = levelBuildChunk(
+              text, section_ends, first_sections[chunk], chunk_sections[chunk], result_arena, threadArena());
+            handoffs[chunk].publish(std::move(result_arena), result);
+        });
+        for ( int chunk = 0; chunk < num_chunks; chunk++ )
+        {
+            bool taken = handoffs[chunk].take(chunk_arenas[chunk], results[chunk]);
+            LASSERT(taken, "Level chunk %i has not been parsed", chunk);
+        }
+    }
+
+    // Merged in file order, so the level numbers do not depend on the split
+    num_invalid = 0;
+    for ( int chunk = 0; chunk < num_chunks; chunk++ )
+    {
+        num_invalid += results[chunk]->num_invalid;
+    }
+    return levelPackMerge(results, num_chunks, arena, scratch, sections);
+}
+
+StrView levelPackBuild(StrView text, Arena& arena, Arena& scratch, int& num_invalid)
+{
+    ArenaScope               scope {scratch};
+    ArenaArray<std::int64_t> section_ends {scratch};
+    levelFindSections(text, section_ends);
+    return levelPackBuildSections(text, section_ends.data(), section_ends.size(), arena, scratch, num_invalid, nullptr);
+}
+
+// Levels are scanned straight from the read buffer. When it is refilled only the section being scanned is kept
+struct LevelStreamState
+{
+    ArenaArray<ParsedLevel> levels;     // complete levels of the data read so far
+    std::int64_t            next_level; // first one not returned yet
+    LevelScan               scan;
+    char*                   buffer;
+    std::int64_t            size;    // bytes in the buffer
+    std::int64_t            scanned; // bytes already seen by the scanner
+    bool                    at_end;
+};
+
+void levelStreamOpen(LevelStream& stream, int fd)
+{
+    stream.fd = fd;
+    stream.num_invalid = 0;
+    stream.arena = Arena {MEGABYTES(1), ARENA_VIRTUAL};
+    stream.arena.set_name("level stream");
+    LevelStreamState* state = stream.arena.allocate<LevelStreamState>();
+    char*             buffer = stream.arena.allocate<char>(LEVEL_STREAM_BUFFER);
+
+    // The array is allocated last so it grows in place. It holds at most the levels of one buffer
+    stream.state = new ( state ) LevelStreamState {
+      {stream.arena, 16}, 0, {buffer, state->levels, {}, SCAN_SEEK_LEVEL, 0, 0, -1, false, 0, {}}, buffer, 0, 0, false};
+    levelScanInit(state->scan);
+}
+
+void levelStreamClose(LevelStream& stream)
+{
+    stream.fd = -1;
+    stream.state = nullptr;
+    stream.arena = Arena {};
+}
+
+// Drops the bytes before the section being scanned
+static void levelStreamCompact(LevelStream& stream)
+{
+    LevelStreamState& state = *stream.state;
+    LevelScan&        scan = state.scan;
+    bool              in_level = scan.state == SCAN_PROPERTIES or scan.state == SCAN_TILES;
+    std::int64_t      keep = in_level ? scan.current.name.data - state.buffer : scan.line_start;
+    if ( keep == 0 and state.size == LEVEL_STREAM_BUFFER )
+    {
+        LCERROR(PARSER, "Level section or line longer than %li bytes. It is skipped", LEVEL_STREAM_BUFFER);
+        stream.num_invalid += in_level;
+        scan.state = SCAN_SEEK_LEVEL;
+        scan.skip_line = true;
+        scan.tile_counter = 0;
+        scan.separator = -1;
+        scan.line_start = state.size;
+        keep = state.size;
+        in_level = false;
+    }
+
+    std::memmove(state.buffer, state.buffer + keep, state.size - keep);
+    state.size -= keep;
+    state.scanned -= keep;
+    scan.line_start -= keep;
+    scan.name_start -= keep;
+    if ( scan.separator >= 0 )
+    {
+        scan.separator -= keep;
+    }
+    if ( in_level )
+    {
+        scan.current.name.data -= keep;
+    }
+}
+
+LevelStreamStatus levelStreamNext(LevelStream& stream, LevelPackEntry& entry, StrView& name)
+{
+    LevelStreamState& state = *stream.state;
+    while ( true )
+    {
+        while ( state.next_level < state.levels.size() )
+        {
+            const ParsedLevel& level = state.levels[state.next_level++];
+            entry = {};
+            if ( levelFillEntry(level, entry) )
+            {
+                name = level.name;
+                return LEVEL_STREAM_LEVEL;
+            }
+            stream.num_invalid++;
+        }
+        if ( state.at_end )
+        {
+            return LEVEL_STREAM_END;
+        }
+
+        // The names of the returned levels point into the part of the buffer that is about to be dropped
+        state.levels.clear();
+        state.next_level = 0;
+        levelStreamCompact(stream);
+        ssize_t count = read(stream.fd, state.buffer + state.size, LEVEL_STREAM_BUFFER - state.size);
+        if ( count < 0 and errno == EINTR )
+        {
+            continue;
+        }
+        if ( count < 0 and (errno == EAGAIN or errno == EWOULDBLOCK) )
+        {
+            return LEVEL_STREAM_WAITING;
+        }
+        if ( count < 0 )
+        {
+            LCERROR(PARSER, "Could not read the level stream: error code %i", errno);
+        }
+        if ( count <= 0 )
+        {
+            state.at_end = true;
+            levelScanEndLine(state.scan, state.size); // The last line might not end with a line break
+            continue;
+        }
+        state.size += count;
+        levelScanFeed(state.scan, state.scanned, state.size);
+        state.scanned = state.size;
+    }
+}
+
+StrView levelPackBuildStream(int fd, Arena& arena, Arena& scratch, int& num_invalid)
+{
+    ArenaScope                 scope {scratch};
+    Arena                      name_storage {GIGABYTES(1), ARENA_VIRTUAL}; // The stream reuses its buffer
+    ArenaArray<LevelPackEntry> entries {scratch};
+    ArenaArray<StrView>        names {scratch};
+    ArenaArray<std::uint64_t>  hashes {scratch};
+    ArenaArray<LevelMeta>      meta {scratch};
+    LevelStream                stream;
+    LevelPackEntry             entry;
+    StrView                    name;
+    levelStreamOpen(stream, fd);
+    while ( levelStreamNext(stream, entry, name) == LEVEL_STREAM_LEVEL )
+    {
+        char* name_copy = name_storage.allocate<char>(name.size);
+        std::memcpy(name_copy, name.data, name.size);
+        entries.push(entry);
+        names.push({name_copy, name.size});
+        hashes.push(levelCanonicalHash(entry));
+        meta.push(levelComputeMeta(entry));
+    }
+    num_invalid = stream.num_invalid;
+    levelStreamClose(stream);
+
+    LevelChunkResult  result {
+      entries.data(), names.data(), hashes.data(), meta.data(), entries.size(), nullptr, 0, num_invalid};
+    LevelChunkResult* results = &result;
+    return levelPackMerge(&results, 1, arena, scratch, nullptr);
+}
+
+bool levelPackCheck(StrView pack)
+{
+    if ( pack.size < (std::int64_t)sizeof(LevelPackHeader) )
+    {
+        return false;
+    }
+    LevelPackHeader header;
+    std::memcpy(&header, pack.data, sizeof(header));
+    if ( std::memcmp(header.magic, LEVEL_PACK_MAGIC, sizeof(header.magic)) != 0 or header.version != LEVEL_PACK_VERSION )
+    {
+        return false;
+    }
+    std::uint64_t levels_end = header.levels_offset + (std::uint64_t)header.num_levels * sizeof(LevelPackEntry);
+    std::uint64_t positions_end = header.positions_offset + (std::uint64_t)header.num_positions * sizeof(LevelPosition);
+    std::uint64_t names_end = (std::uint64_t)header.names_offset + header.names_size;
+    std::uint64_t hashes_end = header.hashes_offset + (std::uint64_t)header.num_levels * sizeof(std::uint64_t);
+    std::uint64_t meta_end = header.meta_offset + (std::uint64_t)header.num_levels * LEVEL_META_COLUMNS_SIZE;
+    if ( header.levels_offset % alignof(LevelPackEntry) or header.hashes_offset % alignof(std::uint64_t) or
+         header.meta_offset % alignof(std::uint16_t) or levels_end > (std::uint64_t)pack.size or
+         positions_end > (std::uint64_t)pack.size or names_end > (std::uint64_t)pack.size or
+         hashes_end > (std::uint64_t)pack.size or meta_end > (std::uint64_t)pack.size )
+    {
+        return false;
+    }
+
+    const LevelPackEntry* levels = reinterpret_cast<const LevelPackEntry*>(pack.data + header.levels_offset);
+    for ( std::uint32_t level = 0; level < header.num_levels; level++ )
+    {
+        const LevelPackEntry& entry = levels[level];
+        if ( (std::uint64_t)entry.first_position + entry.num_boxes + entry.num_goals > header.num_positions or
+             (std::uint64_t)entry.name_offset + entry.name_length > header.names_size )
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// First pass over a collection. Only the first character of each line is looked at: boards are the runs of lines
+// starting with a wall. A level is named by the "Title:" line after its board or else by the comment before it
+static void levelIndexXsb(StrView text, ArenaArray<LevelSection>& sections)
+{
+    LevelSection current {};
+    bool         in_board = false;
+    StrView      comment {nullptr, 0}; // last comment since the previous board
+    StrView      rest = text;
+    while ( rest.size )
+    {
+        StrView      line = strNextLine(rest);
+        StrView      content = strTrimLeft(line);
+        std::int64_t line_offset = line.data - text.data;
+        if ( content.size and content.data[0] == '#' )
+        {
+            if ( not in_board )
+            {
+                current = {line_offset, 0, comment.data ? comment.data - text.data : 0, comment.size};
+                in_board = true;
+            }
+            current.board_end = line_offset + line.size;
+            continue;
+        }
+
+        if ( in_board )
+        {
+            sections.push(current);
+            in_board = false;
+            comment = {nullptr, 0};
+        }
+        if ( content.size and content.data[0] == ';' )
+        {
+            comment = strTrim({content.data + 1, content.size - 1});
+        }
+        else if ( content.size > 6 and strncasecmp(content.data, "title:", 6) == 0 and sections.size() )
+        {
+            StrView       title = strTrim({content.data + 6, content.size - 6});
+            LevelSection& last = sections[sections.size() - 1];
+            last.name_offset = title.data - text.data;
+            last.name_length = title.size;
+        }
+    }
+    if ( in_board )
+    {
+        sections.push(current);
+    }
+}
+
+// Rows keep their leading spaces, which are part of the board
+static StrView levelNextRow(StrView& board)
+{
+    StrView row = strNextLine(board);
+    while ( row.size and strIsSpace(row.data[row.size - 1]) )
+    {
+        row.size--;
+    }
+    return row;
+}
+
+// Centers the board in the grid of the game. Returns false if it does not fit or it can not be played
+static bool levelParseXsb(LevelSet& set, int level)
+{
+    const LevelSection& section = set.sections[level];
+    StrView             board {set.file.data + section.board_start, section.board_end - section.board_start};
+    ParsedLevel         parsed;
+    parsed.name = {set.names + section.name_offset, section.name_length};
+
+    int width = 0;
+    int height = 0;
+    for ( StrView rows = board; rows.size; height++ )
+    {
+        width = std::max<int>(width, levelNextRow(rows).size);
+    }
+    if ( width > LEVEL_WIDTH or height > LEVEL_HEIGHT )
+    {
+        LCERROR(
+          PARSER,
+          "Level %i %.*s is %ix%i tiles. Only levels up to %ix%i fit",
+          level + 1,
+          (int)parsed.name.size,
+          parsed.name.data,
+          width,
+          height,
+          LEVEL_WIDTH,
+          LEVEL_HEIGHT);
+        return false;
+    }
+
+    std::memset(parsed.tiles, TT_EMPTY, sizeof(parsed.tiles));
+    int offset_x = (LEVEL_WIDTH - width) / 2;
+    int offset_y = (LEVEL_HEIGHT - height) / 2;
+    int idx_y = offset_y;
+    for ( StrView rows = board; rows.size; idx_y++ )
+    {
+        StrView row = levelNextRow(rows);
+        for ( std::int64_t idx = 0; idx < row.size; idx++ )
+        {
+            std::int8_t& tile = parsed.tiles[idx_y][offset_x + idx];
+            switch ( row.data[idx] )
+            {
+            case '#':
+                tile = TT_WALL;
+                break;
+            case '@':
+                tile = TT_PLAYER;
+                break;
+            case '+':
+                tile = TT_PLAYER_ON_GOAL;
+                break;
+            case '$':
+                tile = TT_BOX;
+                break;
+            case '.':
+                tile = TT_GOAL;
+                break;
+            case '*':
+                tile = TT_OCCUPIED;
+                break;
+            case ' ':
+            case '-':
+            case '_':
+                break;
+            default:
+                LCERROR(PARSER, "Level %i has an unknown tile '%c'", level + 1, row.data[idx]);
+                return false;
+            }
+        }
+    }
+
+    LevelPackEntry& entry = set.parsed_levels[level];
+    entry = {};
+    if ( not levelFillEntry(parsed, entry) )
+    {
+        return false;
+    }
+    entry.name_offset = section.name_offset;
+    entry.name_length = std::min<std::int64_t>(section.name_length, UINT16_MAX);
+
+    // Appended right after the positions of the previously parsed level
+    LevelPosition* positions = set.position_storage.allocate<LevelPosition>(entry.num_boxes + entry.num_goals);
+    entry.first_position = positions - set.positions;
+    levelWritePositions(entry, positions);
+    return true;
+}
+
+bool levelSetLoadXsb(LevelSet& set, const char* path)
+{
+    levelSetRelease(set);
+    set.file = fileMap(path);
+    if ( not set.file.data )
+    {
+        return false;
+    }
+    if ( set.file.size > UINT32_MAX )
+    {
+        LCERROR(PARSER, "Collection %s is larger than 4 GB", path);
+        fileUnmap(set.file);
+        return false;
+    }
+
+    set.storage = Arena {GIGABYTES(1), ARENA_VIRTUAL};
+    set.storage.set_name("levels");
+    ArenaArray<LevelSection> sections {set.storage};
+    levelIndexXsb({set.file.data, set.file.size}, sections);
+
+    set.num_levels = sections.size();
+    set.sections = sections.data();
+    set.parsed_levels = set.storage.allocate<LevelPackEntry>(set.num_levels);
+    set.levels = set.parsed_levels;
+    set.states = set.storage.allocate<std::uint8_t>(set.num_levels);
+    std::memset(set.states, LEVEL_UNPARSED, set.num_levels);
+    set.names = set.file.data;
+
+    set.position_storage = Arena {GIGABYTES(1), ARENA_VIRTUAL};
+    set.position_storage.set_name("level positions");
+    set.positions = set.position_storage.allocate<LevelPosition>(0); // Base of the positions of every level
+    LCDEBUG(PARSER, "Indexed %i levels in %s", set.num_levels, path);
+    return true;
+}
+
+static void levelSetAppend(LevelSet& set, LevelPackEntry entry, StrView name)
+{
+    entry.name_length = std::min<std::int64_t>(name.size, UINT16_MAX);
+    char* name_copy = set.name_storage.allocate<char>(entry.name_length);
+    std::memcpy(name_copy, name.data, entry.name_length);
+    entry.name_offset = name_copy - set.names;
+
+    LevelPosition* positions = set.position_storage.allocate<LevelPosition>(entry.num_boxes + entry.num_goals);
+    entry.first_position = positions - set.positions;
+    levelWritePositions(entry, positions);
+
+    // Nothing else is allocated on the storage after the levels, so they grow in place
+    set.parsed_levels = set.storage.extend(set.parsed_levels, set.num_levels, set.num_levels + 1);
+    set.parsed_levels[set.num_levels] = entry;
+    set.levels = set.parsed_levels;
+    set.num_levels++;
+}
+
+bool levelSetOpenStream(LevelSet& set, int fd)
+{
+    levelSetRelease(set);
+    set.storage = Arena {GIGABYTES(1), ARENA_VIRTUAL};
+    set.storage.set_name("levels");
+    set.parsed_levels = set.storage.allocate<LevelPackEntry>(0);
+    set.levels = set.parsed_levels;
+    set.position_storage = Arena {GIGABYTES(1), ARENA_VIRTUAL};
+    set.position_storage.set_name("level positions");
+    set.positions = set.position_storage.allocate<LevelPosition>(0);
+    set.name_storage = Arena {GIGABYTES(1), ARENA_VIRTUAL};
+    set.name_storage.set_name("level names");
+    set.names = set.name_storage.allocate<char>(0);
+    levelStreamOpen(set.stream, fd);
+
+    // Blocks until the first level so there is something to play, then the rest is picked up without waiting
+    LevelPackEntry entry;
+    StrView        name;
+    if ( levelStreamNext(set.stream, entry, name) != LEVEL_STREAM_LEVEL )
+    {
+        LCERROR(PARSER, "The level stream has no valid level");
+        levelSetRelease(set);
+        return false;
+    }
+    levelSetAppend(set, entry, name);
+    set.stream_flags = fcntl(fd, F_GETFL);
+    fcntl(fd, F_SETFL, set.stream_flags | O_NONBLOCK);
+    return true;
+}
+
+bool levelSetPollStream(LevelSet& set)
+{
+    if ( not set.stream.state )
+    {
+        return false;
+    }
+    LevelPackEntry    entry;
+    StrView           name;
+    LevelStreamStatus status;
+    while ( (status = levelStreamNext(set.stream, entry, name)) == LEVEL_STREAM_LEVEL )
+    {
+        levelSetAppend(set, entry, name);
+        LCDEBUG(PARSER, "Level %i arrived from the stream", set.num_levels);
+    }
+    return status == LEVEL_STREAM_WAITING;
+}
+
+const LevelPackEntry* levelGet(LevelSet& set, int level)
+{
+    LASSERT(level >= 0 and level < set.num_levels, "Invalid level %i. There are %i levels", level, set.num_levels);
+    if ( not set.states ) // Every level of a pack is valid
+    {
+        return &set.levels[level];
+    }
+    if ( set.states[level] == LEVEL_UNPARSED )
+    {
+        set.states[level] = levelParseXsb(set, level) ? LEVEL_PLAYABLE : LEVEL_UNPLAYABLE;
+    }
+    return set.states[level] == LEVEL_PLAYABLE ? &set.levels[level] : nullptr;
+}
+
+void levelSetAttachPack(LevelSet& set, StrView pack)
+{
+    const LevelPackHeader* header = reinterpret_cast<const LevelPackHeader*>(pack.data);
+    set.hashes = reinterpret_cast<const std::uint64_t*>(pack.data + header->hashes_offset);
+    set.meta = levelMetaColumns(pack.data + header->meta_offset, header->num_levels);
+    set.levels = reinterpret_cast<const LevelPackEntry*>(pack.data + header->levels_offset);
+    set.positions = reinterpret_cast<const LevelPosition*>(pack.data + header->positions_offset);
+    set.names = pack.data + header->names_offset;
+    set.num_levels = header->num_levels;
+}
+
+// Builds the pack in memory, keeping the sections for the reloads
+static bool levelSetLoadText(LevelSet& set, const char* text_path, Arena& scratch)
+{
+    FileView text = fileMap(text_path);
+    if ( not text.data )
+    {
+        return false;
+    }
+    LCDEBUG(PARSER, "Parsing file %s", text_path);
+    ArenaScope               scope {scratch};
+    ArenaArray<std::int64_t> section_ends {scratch};
+    levelFindSections({text.data, text.size}, section_ends);
+    int               num_sections = section_ends.size();
+    Arena             storage {GIGABYTES(1), ARENA_VIRTUAL};
+    storage.set_name("levels");
+    LevelTextSection* sections = storage.allocate<LevelTextSection>(num_sections);
+    levelHashSections({text.data, text.size}, section_ends.data(), num_sections, sections);
+
+    int     num_invalid;
+    StrView pack = levelPackBuildSections(
+      {text.data, text.size}, section_ends.data(), num_sections, storage, scratch, num_invalid, sections);
+    fileUnmap(text);
+    if ( not pack.data )
+    {
+        return false;
+    }
+    levelSetRelease(set);
+    set.storage = std::move(storage);
+    levelSetAttachPack(set, pack);
+    set.text_sections = sections;
+    set.num_text_sections = num_sections;
+    return true;
+}
+
+// The pack is only used while it is at least as recent as the text it was compiled from
+static bool levelPackIsCurrent(const char* pack_path, const char* text_path)
+{
+    struct stat pack_stat;
+    struct stat text_stat;
+    if ( stat(pack_path, &pack_stat) != 0 )
+    {
+        return false;
+    }
+    if ( stat(text_path, &text_stat) == 0 and text_stat.st_mtime > pack_stat.st_mtime )
+    {
+        LCWARN(PARSER, "Level pack %s is older than %s. Run \"make levels\" to update it", pack_path, text_path);
+        return false;
+    }
+    return true;
+}
+
+bool levelSetLoad(LevelSet& set, const char* pack_path, const char* text_path, Arena& scratch)
+{
+    levelSetRelease(set);
+
+    if ( levelPackIsCurrent(pack_path, text_path) )
+    {
+        set.file = fileMap(pack_path);
+        if ( set.file.data and levelPackCheck({set.file.data, set.file.size}) )
+        {
+            levelSetAttachPack(set, {set.file.data, set.file.size});
+            LCDEBUG(PARSER, "Mapped %i levels from %s", set.num_levels, pack_path);
+            return true;
+        }
+        LCWARN(PARSER, "Level pack %s is not valid. Loading %s instead", pack_path, text_path);
+        fileUnmap(set.file);
+    }
+
+    return levelSetLoadText(set, text_path, scratch);
+}
+
+bool levelSetReload(LevelSet& set, const char* text_path, Arena& scratch)
+{
+    if ( not set.text_sections ) // A mapped pack does not know which section each of its levels came from
+    {
+        return levelSetLoadText(set, text_path, scratch);
+    }
+    FileView text = fileMap(text_path);
+    if ( not text.data )
+    {
+        return false;
+    }
+
+    ArenaScope               scope {scratch};
+    ArenaArray<std::int64_t> section_ends {scratch};
+    levelFindSections({text.data, text.size}, section_ends);
+    int               num_sections = section_ends.size();
+    Arena             storage {GIGABYTES(1), ARENA_VIRTUAL};
+    storage.set_name("levels");
+    LevelTextSection* sections = storage.allocate<LevelTextSection>(num_sections);
+    levelHashSections({text.data, text.size}, section_ends.data(), num_sections, sections);
+
+    // Sections are matched by the hash of their bytes, so moving them around does not make them change
+    ArenaHashMap<std::uint64_t, int> old_sections {scratch, set.num_text_sections};
+    for ( int section = 0; section < set.num_text_sections; section++ )
+    {
+        old_sections.insert(set.text_sections[section].hash, section);
+    }
+    int* matches = scratch.allocate<int>(num_sections);
+    int  num_changed = 0;
+    for ( int section = 0; section < num_sections; section++ )
+    {
+        int* old = old_sections.find(sections[section].hash);
+        matches[section] = old ? *old : -1;
+        num_changed += not old;
+    }
+    if ( 2 * num_changed > num_sections ) // Parsing everything on all the threads is faster then
+    {
+        fileUnmap(text);
+        return levelSetLoadText(set, text_path, scratch);
+    }
+
+    // Unchanged sections take their levels from the current pack
+    LevelChunkResult** results = scratch.allocate<LevelChunkResult*>(num_sections);
+    for ( int section = 0; section < num_sections; section++ )
+    {
+        if ( matches[section] < 0 )
+        {
+            results[section] = levelBuildChunk({text.data, text.size}, section_ends.data(), section, 1, scratch, threadArena());
+            continue;
+        }
+        const LevelTextSection& old_section = set.text_sections[matches[section]];
+        StrView*                names = scratch.allocate<StrView>(old_section.num_levels);
+        LevelMeta*              meta = scratch.allocate<LevelMeta>(old_section.num_levels);
+        for ( int level = 0; level < old_section.num_levels; level++ )
+        {
+            names[level] = levelName(set, old_section.first_level + level);
+            meta[level] = levelMetaRow(set.meta, old_section.first_level + level);
+        }
+        results[section] = scratch.allocate<LevelChunkResult>();
+        *results[section] = {
+          set.levels + old_section.first_level,
+          names,
+          set.hashes + old_section.first_level,
+          meta,
+          old_section.num_levels,
+          &old_section.num_levels,
+          1,
+          0};
+    }
+
+    StrView pack = levelPackMerge(results, num_sections, storage, scratch, sections);
+    fileUnmap(text);
+    if ( not pack.data )
+    {
+        return false;
+    }
+    set.storage = std::move(storage); // Releases the previous pack
+    levelSetAttachPack(set, pack);
+    set.text_sections = sections;
+    set.num_text_sections = num_sections;
+    LCINFO(PARSER, "Reloaded %s. Parsed %i of %i sections again", text_path, num_changed, num_sections);
+    return true;
+}
+
+void levelSetRelease(LevelSet& set)
+{
+    fileUnmap(set.file);
+    if ( set.stream.state and set.stream_flags >= 0 )
+    {
+        fcntl(set.stream.fd, F_SETFL, set.stream_flags); // The descriptor is shared with whoever else uses it
+    }
+    levelStreamClose(set.stream);
+    set.stream_flags = -1;
+    set.storage = Arena {};
+    set.position_storage = Arena {};
+    set.name_storage = Arena {};
+    set.sections = nullptr;
+    set.text_sections = nullptr;
+    set.num_text_sections = 0;
+    set.parsed_levels = nullptr;
+    set.states = nullptr;
+    set.levels = nullptr;
+    set.positions = nullptr;
+    set.names = nullptr;
+    set.hashes = nullptr;
+    set.meta = {};
+    set.num_levels = 0;
+}
+
+StrView levelName(const LevelSet& set, int level)
+{
+    LASSERT(level >= 0 and level < set.num_levels, "Invalid level %i. There are %i levels", level, set.num_levels);
+    if ( set.sections ) // Known before the level is parsed
+    {
+        return {set.names + set.sections[level].name_offset, set.sections[level].name_length};
+    }
+    return {set.names + set.levels[level].name_offset, set.levels[level].name_length};
+}
+
+std::uint64_t levelContentHash(const LevelPackEntry& entry)
+{
+    return hashBytes(entry.cells, sizeof(entry.cells));
+}
+
+// Tile classes that do not depend on the orientation. Wall tiles are picked from their neighbours
+static std::uint8_t levelTileClass(int tile_id)
+{
+    switch ( tile_id )
+    {
+    case TT_EMPTY:
+        return 0;
+    case TT_PLAYER:
+        return 2;
+    case TT_BOX:
+        return 3;
+    case TT_GOAL:
+        return 4;
+    case TT_OCCUPIED:
+        return 5;
+    case TT_PLAYER_ON_GOAL:
+        return 6;
+    default:
+        return 1;
+    }
+}
+
+std::uint64_t levelCanonicalHash(const LevelPackEntry& entry)
+{
+    // Only the bounding box of the board counts, so the position in the grid does not matter either
+    std::uint8_t classes[LEVEL_HEIGHT][LEVEL_WIDTH];
+    int          min_x = LEVEL_WIDTH, min_y = LEVEL_HEIGHT, max_x = -1, max_y = -1;
+    for ( int idx_y = 0; idx_y < LEVEL_HEIGHT; idx_y++ )
+    {
+        for ( int idx_x = 0; idx_x < LEVEL_WIDTH; idx_x++ )
+        {
+            classes[idx_y][idx_x] = levelTileClass(levelTile(entry, idx_y * LEVEL_WIDTH + idx_x));
+            if ( classes[idx_y][idx_x] )
+            {
+                min_x = std::min(min_x, idx_x);
+                min_y = std::min(min_y, idx_y);
+                max_x = std::max(max_x, idx_x);
+                max_y = std::max(max_y, idx_y);
+            }
+        }
+    }
+    int width = std::max(max_x - min_x + 1, 0);
+    int height = std::max(max_y - min_y + 1, 0);
+
+    // The board is hashed in each of the 8 orientations and the smallest hash is kept. Bit 2 of the transform
+    // transposes the board and bits 0 and 1 mirror it horizontally and vertically
+    std::uint64_t canonical = UINT64_MAX;
+    for ( int transform = 0; transform < 8; transform++ )
+    {
+        bool         transpose = transform & 4;
+        int          out_width = transpose ? height : width;
+        int          out_height = transpose ? width : height;
+        std::uint8_t board[LEVEL_WIDTH * LEVEL_WIDTH + 8] = {};
+        int          size = 0;
+        for ( int idx_y = 0; idx_y < out_height; idx_y++ )
+        {
+            for ( int idx_x = 0; idx_x < out_width; idx_x++ )
+            {
+                int src_x = transpose ? idx_y : idx_x;
+                int src_y = transpose ? idx_x : idx_y;
+                src_x = (transform & 1) ? width - 1 - src_x : src_x;
+                src_y = (transform & 2) ? height - 1 - src_y : src_y;
+                board[size++] = classes[min_y + src_y][min_x + src_x];
+            }
+        }
+
+        std::uint64_t hash = hashMix(out_width << 8 | out_height);
+        for ( int idx = 0; idx < size; idx += sizeof(std::uint64_t) )
+        {
+            std::uint64_t word;
+            std::memcpy(&word, board + idx, sizeof(word));
+            hash = hashMix(hash ^ word);
+        }
+        canonical = std::min(canonical, hash);
+    }
+    return canonical;
+}
+
+std::uint64_t levelGetHash(LevelSet& set, int level)
+{
+    if ( set.hashes )
+    {
+        return set.hashes[level];
+    }
+    const LevelPackEntry* entry = levelGet(set, level);
+    return entry ? levelCanonicalHash(*entry) : 0;
+}
+
+int levelHashIndexBuild(LevelSet& set, LevelHashIndex& index)
+{
+    int num_copies = 0;
+    for ( int level = 0; level < set.num_levels; level++ )
+    {
+        std::uint64_t hash = levelGetHash(set, level);
+        if ( not hash )
+        {
+            continue;
+        }
+        if ( int* first = index.find(hash) )
+        {
+            StrView name = levelName(set, level);
+            StrView first_name = levelName(set, *first);
+            LCWARN(
+              PARSER,
+              "Level %i %.*s is a copy of level %i %.*s",
+              level + 1,
+              (int)name.size,
+              name.data,
+              *first + 1,
+              (int)first_name.size,
+              first_name.data);
+            num_copies++;
+            continue;
+        }
+        index.insert(hash, level);
+    }
+    return num_copies;
+}
+
+LevelMeta levelComputeMeta(const LevelPackEntry& entry)
+{
+    LevelMeta meta {0, 0, entry.num_boxes, 0, LEVEL_DIFFICULTY_UNKNOWN};
+    int       min_x = LEVEL_WIDTH, min_y = LEVEL_HEIGHT, max_x = -1, max_y = -1;
+    for ( int idx = 0; idx < LEVEL_WIDTH * LEVEL_HEIGHT; idx++ )
+    {
+        if ( levelTile(entry, idx) != TT_EMPTY )
+        {
+            min_x = std::min(min_x, idx % LEVEL_WIDTH);
+            min_y = std::min(min_y, idx / LEVEL_WIDTH);
+            max_x = std::max(max_x, idx % LEVEL_WIDTH);
+            max_y = std::max(max_y, idx / LEVEL_WIDTH);
+        }
+    }
+    meta.width = std::max(max_x - min_x + 1, 0);
+    meta.height = std::max(max_y - min_y + 1, 0);
+
+    // Flood fill from the player through everything that is not a wall
+    bool          visited[LEVEL_WIDTH * LEVEL_HEIGHT] = {};
+    std::uint16_t stack[LEVEL_WIDTH * LEVEL_HEIGHT];
+    int           stack_size = 0;
+    int           start = entry.player.y * LEVEL_WIDTH + entry.player.x;
+    stack[stack_size++] = start;
+    visited[start] = true;
+    while ( stack_size )
+    {
+        int idx = stack[--stack_size];
+        int idx_x = idx % LEVEL_WIDTH;
+        int idx_y = idx / LEVEL_WIDTH;
+        meta.floor_area++;
+        const int offsets[4][2] = {{-1, 0}, {1, 0}, {0, -1}, {0, 1}};
+        for ( int direction = 0; direction < 4; direction++ )
+        {
+            int next_x = idx_x + offsets[direction][0];
+            int next_y = idx_y + offsets[direction][1];
+            int next = next_y * LEVEL_WIDTH + next_x;
+            if ( next_x >= 0 and next_x < LEVEL_WIDTH and next_y >= 0 and next_y < LEVEL_HEIGHT and not visited[next] and
+                 levelTile(entry, next) < 0 )
+            {
+                visited[next] = true;
+                stack[stack_size++] = next;
+            }
+        }
+    }
+    return meta;
+}
+
+LevelMetaTable levelMetaTable(LevelSet& set, Arena& arena)
+{
+    if ( set.meta.num_levels == set.num_levels and set.num_levels )
+    {
+        return set.meta;
+    }
+    char*      columns = reinterpret_cast<char*>(arena.allocate<std::uint16_t>(set.num_levels * LEVEL_META_COLUMNS_SIZE / 2));
+    LevelMeta* meta = arena.allocate<LevelMeta>(set.num_levels);
+    for ( int level = 0; level < set.num_levels; level++ )
+    {
+        const LevelPackEntry* entry = levelGet(set, level);
+        meta[level] = entry ? levelComputeMeta(*entry) : LevelMeta {};
+    }
+    levelWriteMetaColumns(meta, set.num_levels, columns);
+    return levelMetaColumns(columns, set.num_levels);
+}
+
+static bool levelInRange(int value, LevelMetaRange range)
+{
+    return value >= range.min and value <= range.max;
+}
+
+int levelMetaFilter(const LevelMetaTable& table, const LevelMetaFilter& filter, int* levels)
+{
+    // Every level is written and only the ones that pass advance the count, so there is no branch to mispredict
+    int count = 0;
+    for ( int level = 0; level < table.num_levels; level++ )
+    {
+        bool pass = table.width[level] != 0;
+        pass &= levelInRange(table.width[level], filter.width);
+        pass &= levelInRange(table.height[level], filter.height);
+        pass &= levelInRange(table.num_boxes[level], filter.num_boxes);
+        pass &= levelInRange(table.floor_area[level], filter.floor_area);
+        pass &= levelInRange(table.difficulty[level], filter.difficulty);
+        levels[count] = level;
+        count += pass;
+    }
+    return count;
+}
+
+void levelMetaSort(const LevelMetaTable& table, LevelMetaColumn column, int* levels, int count)
+{
+    auto sort_by = [&](const auto* values) {
+        std::stable_sort(levels, levels + count, [&](int level_a, int level_b) { return values[level_a] < values[level_b]; });
+    };
+    switch ( column )
+    {
+    case LEVEL_META_WIDTH:
+        sort_by(table.width);
+        break;
+    case LEVEL_META_HEIGHT:
+        sort_by(table.height);
+        break;
+    case LEVEL_META_BOXES:
+        sort_by(table.num_boxes);
+        break;
+    case LEVEL_META_FLOOR_AREA:
+        sort_by(table.floor_area);
+        break;
+    case LEVEL_META_DIFFICULTY:
+        sort_by(table.difficulty);
+        break;
+    }
+}
@@ -0,0 +1,271 @@
+//
+//  Level data and the compiled level pack
+//
+//  The text format in assets/levels is compiled into a pack by tools/levelpack.cpp ("make levels"). A pack holds the
+//  resolved tile types, with the wall autotiling already applied, the names, the player position and the lists of
+//  boxes and goals of every valid level. Tiles are stored as 4-bit cells, so an entry takes two cache lines, and
+//  levels with the same name share it. The game maps the pack and reads it in place. If there is no pack, or it is
+//  older than the text file, the same pack is built in memory from the text instead.
+//
+//  Standard XSB/SOK collections are read as well. Opening one only records where each level is in the file, and a
+//  level is parsed the first time it is requested. Levels must fit in the grid of the game
+//
+//  The text format can also be streamed from any file descriptor, such as a pipe. Levels come out as soon as their
+//  grid is complete and only the section being read is kept in memory
+//
+//  Every level also gets a canonical hash of its board that is the same for its rotated and mirrored copies, so
+//  duplicates across collections are found with a lookup instead of comparing the grids.
+//
+//  Metadata that menus and tools filter and sort by is kept in columns, one array per field, so a query over
+//  thousands of levels reads a few contiguous arrays and no tile data.
+//
+//  Layout, all values in native byte order and offsets from the start of the file:
+//    LevelPackHeader
+//    u64 hashes[num_levels]       canonical hash of each level
+//    LevelMetaTable columns       u16 num_boxes, floor_area and difficulty, then u8 width and height, each [num_levels]
+//    LevelPackEntry[num_levels]
+//    LevelPosition[num_positions] boxes then goals of each level
+//    char names[names_size]       not NUL-terminated
+//
+
+#pragma once
+
+#include "arena.hpp"
+#include "arena_hash_map.hpp"
+#include "file_io.hpp"
+
+#include <cstdint>
+
+const int           LEVEL_WIDTH = 16;
+const int           LEVEL_HEIGHT = 14;
+const char          LEVEL_PACK_MAGIC[4] = {'Y', 'L', 'V', 'L'};
+const std::uint32_t LEVEL_PACK_VERSION = 4;
+const std::uint16_t LEVEL_DIFFICULTY_UNKNOWN = UINT16_MAX; // No level has been rated by a solver yet
+
+enum TileType
+{
+    TT_PLAYER = -1,
+    TT_BOX = -2,
+    TT_GOAL = -3,
+    TT_OCCUPIED = -4,
+    TT_PLAYER_ON_GOAL = -5,
+    TT_EMPTY = -20,
+    TT_WALL = 0,
+    TT_WALL_TRANS = 1,
+    TT_WALL_CORNER = 2,
+    TT_WALL_TRANS_END = 3,
+};
+
+// Tile type of each 4-bit cell value
+const std::int8_t LEVEL_CELL_TILES[16] = {
+  TT_EMPTY,
+  TT_WALL,
+  TT_WALL_TRANS,
+  TT_WALL_CORNER,
+  TT_WALL_TRANS_END,
+  TT_PLAYER,
+  TT_BOX,
+  TT_GOAL,
+  TT_OCCUPIED,
+  TT_PLAYER_ON_GOAL,
+  TT_EMPTY,
+  TT_EMPTY,
+  TT_EMPTY,
+  TT_EMPTY,
+  TT_EMPTY,
+  TT_EMPTY};
+
+struct LevelPosition
+{
+    std::uint8_t x, y;
+};
+
+struct LevelPackHeader
+{
+    char          magic[4];
+    std::uint32_t version;
+    std::uint32_t num_levels;
+    std::uint32_t levels_offset;
+    std::uint32_t positions_offset;
+    std::uint32_t num_positions;
+    std::uint32_t names_offset;
+    std::uint32_t names_size;
+    std::uint32_t hashes_offset;
+    std::uint32_t meta_offset;
+};
+
+struct LevelPackEntry
+{
+    std::uint8_t  cells[LEVEL_WIDTH * LEVEL_HEIGHT / 2]; // two tiles per byte, the first one in the low nibble
+    std::uint32_t name_offset;                      // from the start of the names
+    std::uint16_t name_length;
+    LevelPosition player;
+    std::uint32_t first_position; // index of the first box. The goals follow the boxes
+    std::uint16_t num_boxes;      // boxes that start on a goal are in both lists
+    std::uint16_t num_goals;
+};
+
+static_assert(sizeof(LevelPackHeader) == 40 and sizeof(LevelPackEntry) == 128, "The pack layout must not change silently");
+
+// "idx" goes through the rows one after another
+inline TileType levelTile(const LevelPackEntry& entry, int idx)
+{
+    return static_cast<TileType>(LEVEL_CELL_TILES[(entry.cells[idx / 2] >> (4 * (idx % 2))) & 0xf]);
+}
+
+// Metadata of one level
+struct LevelMeta
+{
+    std::uint8_t  width; // of the bounding box of the board. 0 if the level can not be played
+    std::uint8_t  height;
+    std::uint16_t num_boxes;
+    std::uint16_t floor_area; // tiles the player can reach when the boxes are left aside
+    std::uint16_t difficulty;
+};
+
+enum LevelMetaColumn
+{
+    LEVEL_META_WIDTH,
+    LEVEL_META_HEIGHT,
+    LEVEL_META_BOXES,
+    LEVEL_META_FLOOR_AREA,
+    LEVEL_META_DIFFICULTY,
+};
+
+// The metadata of every level of a set, one array per field
+struct LevelMetaTable
+{
+    const std::uint16_t* num_boxes;
+    const std::uint16_t* floor_area;
+    const std::uint16_t* difficulty;
+    const std::uint8_t*  width;
+    const std::uint8_t*  height;
+    int                  num_levels;
+};
+
+struct LevelMetaRange
+{
+    int min = 0;
+    int max = INT32_MAX;
+};
+
+// Levels pass if every field is within its range. Levels that can not be played never do
+struct LevelMetaFilter
+{
+    LevelMetaRange width;
+    LevelMetaRange height;
+    LevelMetaRange num_boxes;
+    LevelMetaRange floor_area;
+    LevelMetaRange difficulty;
+};
+
+// Where a level of a collection is in its source
+struct LevelSection
+{
+    std::int64_t board_start;
+    std::int64_t board_end;
+    std::int64_t name_offset;
+    std::int64_t name_length;
+};
+
+// A "[name]" section of the text format and the levels of the pack that came from it
+struct LevelTextSection
+{
+    std::uint64_t hash; // of the bytes of the section
+    std::int32_t  first_level;
+    std::int32_t  num_levels; // 0 if the level of the section is not valid
+};
+
+enum LevelState
+{
+    LEVEL_UNPARSED,
+    LEVEL_PLAYABLE,
+    LEVEL_UNPLAYABLE,
+};
+
+const std::int64_t LEVEL_STREAM_BUFFER = KILOBYTES(64); // Longest section a stream can read
+
+enum LevelStreamStatus
+{
+    LEVEL_STREAM_LEVEL,   // a valid level was read
+    LEVEL_STREAM_WAITING, // a non-blocking descriptor has no more data yet
+    LEVEL_STREAM_END,
+};
+
+struct LevelStreamState;
+
+// Reads the text format from a descriptor it does not own
+struct LevelStream
+{
+    int               fd = -1;
+    int               num_invalid;
+    Arena             arena; // the read buffer and the levels scanned but not returned yet
+    LevelStreamState* state;
+};
+
+// Levels read from a mapped pack, from a pack built in memory or parsed on demand from a collection
+struct LevelSet
+{
+    Arena                 storage; // holds the pack when it is built from the text format
+    FileView              file;    // mapping of the pack file or of the collection
+    const LevelPackEntry* levels;
+    const LevelPosition*  positions;
+    const char*           names;
+    const std::uint64_t*  hashes; // canonical hash of each level. Only packs store them
+    LevelMetaTable        meta;   // only packs store it as well. Empty otherwise
+    int                   num_levels;
+
+    // Only used by collections
+    const LevelSection* sections;
+    LevelPackEntry*     parsed_levels; // same array as "levels"
+    std::uint8_t*       states;        // LevelState of each level
+    Arena               position_storage; // nothing else is allocated here, so the positions stay contiguous
+    std::int64_t        num_positions;
+
+    // Only used by packs built from the text format. Lets a reload parse only the sections that changed
+    const LevelTextSection* text_sections;
+    int                     num_text_sections;
+
+    // Only used by streams. New levels are appended to "parsed_levels" as they arrive
+    LevelStream stream;
+    int         stream_flags; // of the descriptor before it was made non-blocking
+    Arena       name_storage;
+};
+
+// Parses the text format and lays out a pack on the arena. Invalid levels are reported and left out.
+// Returns an empty view if the pack could not be built
+StrView levelPackBuild(StrView text, Arena& arena, Arena& scratch, int& num_invalid);
+StrView levelPackBuildStream(int fd, Arena& arena, Arena& scratch, int& num_invalid); // reads the text until the end
+bool    levelPackCheck(StrView pack); // whether the header and every offset are consistent with the size
+
+// Maps the pack, falling back to the text file. The scratch arena is only used during the call
+bool    levelSetLoad(LevelSet& set, const char* pack_path, const char* text_path, Arena& scratch);
+bool    levelSetReload(LevelSet& set, const char* text_path, Arena& scratch); // picks up the changes of the text
+bool    levelSetLoadXsb(LevelSet& set, const char* path); // indexes a collection without parsing its levels
+bool    levelSetOpenStream(LevelSet& set, int fd);            // waits for the first level. Returns false if there is none
+bool    levelSetPollStream(LevelSet& set); // appends the levels that arrived. Returns false once the stream has ended
+void    levelSetAttachPack(LevelSet& set, StrView pack); // views a checked pack that the caller keeps alive
+void    levelSetRelease(LevelSet& set);
+StrView levelName(const LevelSet& set, int level);
+
+std::uint64_t levelContentHash(const LevelPackEntry& entry);   // hash of the tiles. Equal for equal levels
+std::uint64_t levelCanonicalHash(const LevelPackEntry& entry); // same for the rotated and mirrored copies too
+std::uint64_t levelGetHash(LevelSet& set, int level);          // canonical hash, or 0 if the level can not be played
+
+// Canonical hash to the first level that has it. Answers whether a level has been seen before in O(1)
+using LevelHashIndex = ArenaHashMap<std::uint64_t, int>;
+int levelHashIndexBuild(LevelSet& set, LevelHashIndex& index); // reports the copies and returns how many there are
+
+void              levelStreamOpen(LevelStream& stream, int fd);
+void              levelStreamClose(LevelStream& stream);
+// The name points into the read buffer and is only valid until the next call. Invalid levels are reported and skipped
+LevelStreamStatus levelStreamNext(LevelStream& stream, LevelPackEntry& entry, StrView& name);
+
+LevelMeta      levelComputeMeta(const LevelPackEntry& entry);
+LevelMetaTable levelMetaTable(LevelSet& set, Arena& arena); // stored in packs, computed on the arena for other sets
+// "levels" needs room for every level of the table. Returns how many passed, in level order
+int            levelMetaFilter(const LevelMetaTable& table, const LevelMetaFilter& filter, int* levels);
+void           levelMetaSort(const LevelMetaTable& table, LevelMetaColumn column, int* levels, int count); // stable, ascending
+
+// Returns nullptr if the level can not be played. Levels of a collection are parsed here on first use
+const LevelPackEntry* levelGet(LevelSet& set, int level);
@@ -1,33 +1,791 @@
 #include "log.hpp"
 
+#include "log_binary.hpp"
+
+#include <atomic>
+#include <csignal>
 #include <cstdarg>
+#include <cstdint>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <ctime>
+#include <fcntl.h>
+#include <thread>
+#include <unistd.h>
 
 #ifndef NDEBUG  // Sets the default log level
-static int LogLevel = Logger::LOG_DEBUG;
+#    define LOG_DEFAULT_LEVEL Logger::LOG_DEBUG
 #else
-static int LogLevel = Logger::LOG_INFO;
+#    define LOG_DEFAULT_LEVEL Logger::LOG_INFO
 #endif
 
+int Logger::category_levels[CAT_COUNT] = {
+  LOG_DEFAULT_LEVEL,
+  LOG_DEFAULT_LEVEL,
+  LOG_DEFAULT_LEVEL,
+  LOG_DEFAULT_LEVEL,
+  LOG_DEFAULT_LEVEL};
+
+// The runtime level of a category lets through whatever is either written out or kept by the flight recorder
+static int g_output_levels[Logger::CAT_COUNT] = {
+  LOG_DEFAULT_LEVEL,
+  LOG_DEFAULT_LEVEL,
+  LOG_DEFAULT_LEVEL,
+  LOG_DEFAULT_LEVEL,
+  LOG_DEFAULT_LEVEL};
+static int g_recorder_level = LOG_DEFAULT_LEVEL;
+
 const char* level_strings[] = {"TRACE", "DEBUG", "INFO", "WARN", "ERROR"};
+const char* category_strings[] = {"", "parser", "render", "input", "arena"};
+
+const int LOG_RING_SIZE = 1024;       // Number of messages that can wait to be written. Must be a power of two
+const int LOG_MESSAGE_SIZE = 256;     // Longer messages are truncated
+const int LOG_FLUSH_INTERVAL_US = 1000; // Sleep of the writer thread when there is nothing to write
+const int LOG_MAX_FORMATS = 1024;     // Distinct format strings that can be used in binary mode. Power of two
+
+// Slot of the bounded multi-producer queue. The sequence tells whether the slot is free for the producer at that
+// position or holds a message ready for the consumer
+struct LogSlot
+{
+    std::atomic<std::uint64_t> sequence;
+    std::time_t                time;
+    int                        level;
+    int                        category;
+    int                        size; // Size of the binary record in the message buffer. Zero for text messages
+    char                       message[LOG_MESSAGE_SIZE];
+};
+
+// Format strings seen in binary mode. The index in the table is the ID written to the stream
+struct LogFormat
+{
+    std::atomic<const char*> fmt;
+    std::atomic<bool>        ready;
+    int                      num_args;
+    LogArgType               arg_types[LOG_MAX_ARGS];
+};
+
+static struct
+{
+    std::atomic<bool> enabled;
+    std::FILE*        file;
+    LogFormat         formats[LOG_MAX_FORMATS];
+    bool              format_written[LOG_MAX_FORMATS]; // Only touched by the writer thread
+} g_binary;
+
+static struct
+{
+    LogSlot                    slots[LOG_RING_SIZE];
+    alignas(64) std::atomic<std::uint64_t> enqueue_pos;
+    alignas(64) std::uint64_t  dequeue_pos; // Only touched by the writer thread
+    std::atomic<std::uint64_t> num_dropped;
+    std::atomic<bool>          running;
+    std::thread                writer;
+} g_ring;
+
+const int RECORDER_SIZE = 512;          // Number of records kept by the flight recorder. Must be a power of two
+const int RECORDER_MESSAGE_SIZE = 104; // Keeps each record at 128 bytes
+const int RECORDER_FRAME_MARKER = -1;  // Level of the records that mark the start of a frame
+
+// Each record is a seqlock. "sequence" is odd while a writer fills it and 2 * (position + 1) once it is complete
+struct RecorderRecord
+{
+    std::atomic<std::uint64_t> sequence;
+    std::int64_t               time_ns; // Real time, so the dump can show the time of the day without calling localtime
+    std::int32_t               level;
+    std::int32_t               category; // Or the frame number for frame markers
+    char                       message[RECORDER_MESSAGE_SIZE];
+};
+static_assert(sizeof(RecorderRecord) == 128, "Records are kept at two cache lines");
+
+static struct
+{
+    RecorderRecord             records[RECORDER_SIZE];
+    std::atomic<std::uint64_t> head;
+    char                       dump_path[256];
+    std::atomic<bool>          dumped;
+} g_recorder;
+
+static std::int64_t recorderTimeNs()
+{
+    timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+// Claims the oldest record and fills everything but the message. If the ring wraps around while another thread is
+// still filling the same record, or has already filled it with a newer one, returns nullptr instead of mixing both
+static RecorderRecord* recorderClaim(int level, int category, std::uint64_t& pos)
+{
+    pos = g_recorder.head.fetch_add(1, std::memory_order_relaxed);
+    RecorderRecord& record = g_recorder.records[pos & (RECORDER_SIZE - 1)];
+    std::uint64_t   sequence = record.sequence.load(std::memory_order_relaxed);
+    if ( sequence % 2 or sequence > 2 * pos or
+         not record.sequence.compare_exchange_strong(sequence, 2 * pos + 1, std::memory_order_acquire) )
+    {
+        return nullptr;
+    }
+    record.time_ns = recorderTimeNs();
+    record.level = level;
+    record.category = category;
+    return &record;
+}
+
+static void recorderWrite(int level, int category, const char* message)
+{
+    std::uint64_t   pos;
+    RecorderRecord* record = recorderClaim(level, category, pos);
+    if ( not record )
+    {
+        return;
+    }
+    std::strncpy(record->message, message, RECORDER_MESSAGE_SIZE - 1);
+    record->message[RECORDER_MESSAGE_SIZE - 1] = '\0';
+    record->sequence.store(2 * pos + 2, std::memory_order_release);
+}
+
+// Formats straight into the record, for messages that are not formatted otherwise
+static void recorderFormat(int level, int category, const char* fmt, std::va_list args)
+{
+    std::uint64_t   pos;
+    RecorderRecord* record = recorderClaim(level, category, pos);
+    if ( not record )
+    {
+        return;
+    }
+    vsnprintf(record->message, RECORDER_MESSAGE_SIZE, fmt, args);
+    record->sequence.store(2 * pos + 2, std::memory_order_release);
+}
+
+// Minimal formatting that is safe to use from a signal handler
+static char* appendString(char* out, const char* str)
+{
+    while ( *str )
+    {
+        *out++ = *str++;
+    }
+    return out;
+}
+
+static char* appendNumber(char* out, std::int64_t number, int min_digits)
+{
+    char digits[24];
+    int  num_digits = 0;
+    if ( number < 0 )
+    {
+        *out++ = '-';
+        number = -number;
+    }
+    do
+    {
+        digits[num_digits++] = '0' + number % 10;
+        number /= 10;
+    } while ( number or num_digits < min_digits );
+    while ( num_digits )
+    {
+        *out++ = digits[--num_digits];
+    }
+    return out;
+}
+
+static void writeMessage(std::time_t time_epox, int level, int category, const char* message)
+{
+    std::tm time;
+    localtime_r(&time_epox, &time);
+    char buf[16];
+    buf[strftime(buf, sizeof(buf), "%H:%M:%S", &time)] = '\0';
+
+    if ( category == Logger::CAT_GENERAL )
+    {
+        fprintf(stderr, "%s [%-5s]: %s\n", buf, level_strings[level], message);
+    }
+    else
+    {
+        fprintf(stderr, "%s [%-5s] %s: %s\n", buf, level_strings[level], category_strings[category], message);
+    }
+}
+
+// The definition of a format string is written right before its first message, from the format table itself
+static void writeBinaryRecord(const LogSlot& slot)
+{
+    std::uint16_t id;
+    std::memcpy(&id, slot.message + 3, sizeof(id));
+    if ( not g_binary.format_written[id] )
+    {
+        const char*   fmt = g_binary.formats[id].fmt.load(std::memory_order_acquire);
+        std::uint8_t  type = LOG_RECORD_FORMAT;
+        std::uint16_t length = std::strlen(fmt);
+        fwrite(&type, sizeof(type), 1, g_binary.file);
+        fwrite(&id, sizeof(id), 1, g_binary.file);
+        fwrite(&length, sizeof(length), 1, g_binary.file);
+        fwrite(fmt, sizeof(char), length, g_binary.file);
+        g_binary.format_written[id] = true;
+    }
+    fwrite(slot.message, sizeof(char), slot.size, g_binary.file);
+}
+
+// Writes every message that is ready. Returns the number of messages written
+static int drainRing()
+{
+    int written = 0;
+    while ( true )
+    {
+        LogSlot&      slot = g_ring.slots[g_ring.dequeue_pos & (LOG_RING_SIZE - 1)];
+        std::uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+        if ( sequence != g_ring.dequeue_pos + 1 )
+        {
+            break;
+        }
+        if ( slot.size )
+        {
+            writeBinaryRecord(slot);
+        }
+        else
+        {
+            writeMessage(slot.time, slot.level, slot.category, slot.message);
+        }
+        slot.sequence.store(g_ring.dequeue_pos + LOG_RING_SIZE, std::memory_order_release);
+        g_ring.dequeue_pos++;
+        written++;
+    }
+
+    static std::uint64_t num_dropped_reported = 0;
+    std::uint64_t        num_dropped = g_ring.num_dropped.load(std::memory_order_relaxed);
+    if ( num_dropped != num_dropped_reported )
+    {
+        fprintf(stderr, "Log buffer was full. %lu messages were dropped\n", num_dropped - num_dropped_reported);
+        if ( g_binary.file ) // Still open while the last records are drained on stop
+        {
+            std::uint8_t  type = LOG_RECORD_DROPPED;
+            std::uint64_t count = num_dropped - num_dropped_reported;
+            fwrite(&type, sizeof(type), 1, g_binary.file);
+            fwrite(&count, sizeof(count), 1, g_binary.file);
+        }
+        num_dropped_reported = num_dropped;
+    }
+    return written;
+}
+
+static void writerLoop()
+{
+    while ( g_ring.running.load(std::memory_order_acquire) )
+    {
+        if ( not drainRing() )
+        {
+            fflush(stderr);
+            if ( g_binary.enabled.load(std::memory_order_relaxed) )
+            {
+                fflush(g_binary.file);
+            }
+            timespec interval {0, LOG_FLUSH_INTERVAL_US * 1000};
+            nanosleep(&interval, nullptr);
+        }
+    }
+    drainRing();
+    fflush(stderr);
+}
+
+// Claims a free slot to write a message into. Never blocks: if the ring is full the message is dropped and counted
+static LogSlot* claimSlot(std::uint64_t& pos)
+{
+    pos = g_ring.enqueue_pos.load(std::memory_order_relaxed);
+    while ( true )
+    {
+        LogSlot*     slot = &g_ring.slots[pos & (LOG_RING_SIZE - 1)];
+        std::int64_t diff = (std::int64_t)slot->sequence.load(std::memory_order_acquire) - (std::int64_t)pos;
+        if ( diff == 0 )
+        {
+            if ( g_ring.enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed) )
+            {
+                return slot;
+            }
+        }
+        else if ( diff < 0 )
+        {
+            g_ring.num_dropped.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        else
+        {
+            pos = g_ring.enqueue_pos.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+static void enqueueMessage(int level, int category, const char* message)
+{
+    std::uint64_t pos;
+    LogSlot*      slot = claimSlot(pos);
+    if ( not slot )
+    {
+        return;
+    }
+    slot->time = std::time(nullptr);
+    slot->level = level;
+    slot->category = category;
+    slot->size = 0;
+    std::memcpy(slot->message, message, LOG_MESSAGE_SIZE);
+    slot->sequence.store(pos + 1, std::memory_order_release);
+}
+
+// Returns the ID of the format string, registering it on first use. -1 if the table is full
+static int formatId(const char* fmt)
+{
+    std::uint64_t hash = reinterpret_cast<std::uintptr_t>(fmt) * 0x9e3779b97f4a7c15ULL;
+    for ( int probe = 0; probe < LOG_MAX_FORMATS; probe++ )
+    {
+        int         id = ((hash >> 40) + probe) & (LOG_MAX_FORMATS - 1);
+        LogFormat&  format = g_binary.formats[id];
+        const char* current = format.fmt.load(std::memory_order_acquire);
+        if ( not current and format.fmt.compare_exchange_strong(current, fmt, std::memory_order_acq_rel) )
+        {
+            LogConversion conversion;
+            const char*   next = fmt;
+            format.num_args = 0;
+            while ( logNextConversion(next, conversion) )
+            {
+                for ( int idx = 0; idx < conversion.num_args and format.num_args < LOG_MAX_ARGS; idx++ )
+                {
+                    format.arg_types[format.num_args++] = conversion.arg_types[idx];
+                }
+                next = conversion.end;
+            }
+            format.ready.store(true, std::memory_order_release);
+            return id;
+        }
+        if ( current == fmt ) // Might have been registered by another thread a moment ago
+        {
+            while ( not format.ready.load(std::memory_order_acquire) )
+            {
+                std::this_thread::yield();
+            }
+            return id;
+        }
+    }
+    return -1;
+}
+
+// Wide characters are written as UTF-8, invalid ones as U+FFFD. Returns the number of bytes
+static int encodeUtf8(std::uint32_t code_point, char* out)
+{
+    if ( code_point > 0x10FFFF or (code_point >= 0xD800 and code_point <= 0xDFFF) )
+    {
+        code_point = 0xFFFD;
+    }
+    if ( code_point < 0x80 )
+    {
+        out[0] = code_point;
+        return 1;
+    }
+    if ( code_point < 0x800 )
+    {
+        out[0] = 0xC0 | (code_point >> 6);
+        out[1] = 0x80 | (code_point & 0x3F);
+        return 2;
+    }
+    if ( code_point < 0x10000 )
+    {
+        out[0] = 0xE0 | (code_point >> 12);
+        out[1] = 0x80 | ((code_point >> 6) & 0x3F);
+        out[2] = 0x80 | (code_point & 0x3F);
+        return 3;
+    }
+    out[0] = 0xF0 | (code_point >> 18);
+    out[1] = 0x80 | ((code_point >> 12) & 0x3F);
+    out[2] = 0x80 | ((code_point >> 6) & 0x3F);
+    out[3] = 0x80 | (code_point & 0x3F);
+    return 4;
+}
+
+template<typename T>
+static char* putValue(char* out, T value)
+{
+    std::memcpy(out, &value, sizeof(T));
+    return out + sizeof(T);
+}
 
-void Logger::set_level(int log_level) { LogLevel = log_level; }
+// Copies the raw arguments instead of formatting them. Only strings are truncated if the record does not fit
+static void enqueueBinary(int level, int category, const char* fmt, std::va_list args)
+{
+    int id = formatId(fmt);
+    if ( id < 0 )
+    {
+        g_ring.num_dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    const LogFormat& format = g_binary.formats[id];
+
+    std::uint64_t pos;
+    LogSlot*      slot = claimSlot(pos);
+    if ( not slot )
+    {
+        return;
+    }
+
+    timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    char* out = slot->message;
+    out = putValue<std::uint8_t>(out, LOG_RECORD_MESSAGE);
+    out = putValue<std::uint8_t>(out, level);
+    out = putValue<std::uint8_t>(out, category);
+    out = putValue<std::uint16_t>(out, id);
+    out = putValue<std::int64_t>(out, now.tv_sec * 1000000000LL + now.tv_nsec);
+    char* size_field = out;
+    out += sizeof(std::uint16_t);
+    char* args_start = out;
+
+    int last_int = 0; // The precision of "%.*s" comes right before the string
+    for ( int idx = 0; idx < format.num_args; idx++ )
+    {
+        switch ( format.arg_types[idx] )
+        {
+        case LOG_ARG_INT32:
+            last_int = va_arg(args, int);
+            out = putValue<std::int32_t>(out, last_int);
+            break;
+        case LOG_ARG_INT64:
+            out = putValue<std::int64_t>(out, va_arg(args, long long));
+            break;
+        case LOG_ARG_DOUBLE:
+            out = putValue<double>(out, va_arg(args, double));
+            break;
+        case LOG_ARG_LONG_DOUBLE:
+            out = putValue<double>(out, va_arg(args, long double));
+            break;
+        case LOG_ARG_POINTER:
+            out = putValue<std::uint64_t>(out, reinterpret_cast<std::uintptr_t>(va_arg(args, void*)));
+            break;
+        case LOG_ARG_STRING:
+        case LOG_ARG_STRING_PRECISION:
+        {
+            const char* str = va_arg(args, const char*);
+            str = str ? str : "(null)";
+            // Leaves room for the worst case of the arguments that follow
+            std::int64_t room = slot->message + LOG_MESSAGE_SIZE - out - 2 - 10 * (format.num_args - idx - 1);
+            if ( format.arg_types[idx] == LOG_ARG_STRING_PRECISION and last_int >= 0 and last_int < room )
+            {
+                room = last_int;
+            }
+            std::uint16_t length = strnlen(str, room > 0 ? room : 0);
+            out = putValue<std::uint16_t>(out, length);
+            std::memcpy(out, str, length);
+            out += length;
+            break;
+        }
+        case LOG_ARG_WIDE_STRING:
+        case LOG_ARG_WIDE_STRING_PRECISION:
+        {
+            const wchar_t* str = va_arg(args, const wchar_t*);
+            str = str ? str : L"(null)";
+            std::int64_t room = slot->message + LOG_MESSAGE_SIZE - out - 2 - 10 * (format.num_args - idx - 1);
+            if ( format.arg_types[idx] == LOG_ARG_WIDE_STRING_PRECISION and last_int >= 0 and last_int < room )
+            {
+                room = last_int; // Counts bytes of the converted string, as printf does
+            }
+            char* length_field = out;
+            char* chars = out + sizeof(std::uint16_t);
+            out = chars;
+            // Stops before reading past the precision, so strings that are not NUL-terminated are fine as well
+            for ( ; out - chars < room and *str; str++ )
+            {
+                char encoded[4];
+                int  encoded_size = encodeUtf8(*str, encoded);
+                if ( out - chars + encoded_size > room )
+                {
+                    break;
+                }
+                std::memcpy(out, encoded, encoded_size);
+                out += encoded_size;
+            }
+            putValue<std::uint16_t>(length_field, out - chars);
+            break;
+        }
+        }
+    }
+    putValue<std::uint16_t>(size_field, out - args_start);
+
+    slot->size = out - slot->message;
+    slot->sequence.store(pos + 1, std::memory_order_release);
+}
+
+static void logMessage(int category, int level, const char* fmt, std::va_list args)
+{
+    // Binary records are not formatted, but the flight recorder still keeps text so a dump has the same context as in
+    // text mode. Only messages at or over the recorder level pay for formatting, and only the size of a record
+    if ( g_binary.enabled.load(std::memory_order_relaxed) )
+    {
+        if ( level >= g_recorder_level )
+        {
+            std::va_list recorder_args;
+            va_copy(recorder_args, args);
+            recorderFormat(level, category, fmt, recorder_args);
+            va_end(recorder_args);
+        }
+        if ( level >= g_output_levels[category] )
+        {
+            enqueueBinary(level, category, fmt, args);
+        }
+        return;
+    }
+
+    char message[LOG_MESSAGE_SIZE];
+    vsnprintf(message, LOG_MESSAGE_SIZE, fmt, args);
+
+    if ( level >= g_recorder_level )
+    {
+        recorderWrite(level, category, message);
+    }
+    if ( level < g_output_levels[category] )
+    {
+        return;
+    }
+
+    if ( g_ring.running.load(std::memory_order_acquire) )
+    {
+        enqueueMessage(level, category, message);
+    }
+    else
+    {
+        writeMessage(std::time(nullptr), level, category, message);
+    }
+}
+
+static void updateCategoryLevels()
+{
+    for ( int category = 0; category < Logger::CAT_COUNT; category++ )
+    {
+        int output_level = g_output_levels[category];
+        Logger::category_levels[category] = output_level < g_recorder_level ? output_level : g_recorder_level;
+    }
+}
+
+void Logger::set_level(int log_level)
+{
+    for ( int& output_level : g_output_levels )
+    {
+        output_level = log_level;
+    }
+    updateCategoryLevels();
+}
+
+void Logger::set_category_level(int category, int log_level)
+{
+    g_output_levels[category] = log_level;
+    updateCategoryLevels();
+}
+
+void Logger::set_recorder_level(int log_level)
+{
+    g_recorder_level = log_level;
+    updateCategoryLevels();
+}
+
+void Logger::record_frame(long frame)
+{
+    recorderWrite(RECORDER_FRAME_MARKER, (std::int32_t)frame, "");
+}
+
+void Logger::dump_recorder(int fd)
+{
+    std::uint64_t head = g_recorder.head.load(std::memory_order_acquire);
+    std::uint64_t first = head > RECORDER_SIZE ? head - RECORDER_SIZE : 0;
+    for ( std::uint64_t pos = first; pos < head; pos++ )
+    {
+        // Copies the record and skips it if it was not complete, or was overwritten while it was being copied
+        RecorderRecord& slot = g_recorder.records[pos & (RECORDER_SIZE - 1)];
+        std::uint64_t   sequence = slot.sequence.load(std::memory_order_acquire);
+        if ( sequence != 2 * pos + 2 )
+        {
+            continue;
+        }
+        RecorderRecord record;
+        record.time_ns = slot.time_ns;
+        record.level = slot.level;
+        record.category = slot.category;
+        std::memcpy(record.message, slot.message, RECORDER_MESSAGE_SIZE);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if ( slot.sequence.load(std::memory_order_relaxed) != sequence )
+        {
+            continue;
+        }
+        record.message[RECORDER_MESSAGE_SIZE - 1] = '\0';
+
+        char  line[RECORDER_MESSAGE_SIZE + 64];
+        char* out = line;
+
+        std::int64_t millis_of_day = (record.time_ns / 1000000) % (24 * 3600 * 1000LL);
+        out = appendNumber(out, millis_of_day / 3600000, 2);
+        *out++ = ':';
+        out = appendNumber(out, millis_of_day / 60000 % 60, 2);
+        *out++ = ':';
+        out = appendNumber(out, millis_of_day / 1000 % 60, 2);
+        *out++ = '.';
+        out = appendNumber(out, millis_of_day % 1000, 3);
+
+        if ( record.level == RECORDER_FRAME_MARKER )
+        {
+            out = appendString(out, " ---- frame ");
+            out = appendNumber(out, record.category, 1);
+        }
+        else if ( record.level >= LOG_TRACE and record.level <= LOG_ERROR and record.category >= 0
+                  and record.category < CAT_COUNT )
+        {
+            out = appendString(out, " [");
+            out = appendString(out, level_strings[record.level]);
+            out = appendString(out, "] ");
+            if ( record.category != CAT_GENERAL )
+            {
+                out = appendString(out, category_strings[record.category]);
+                out = appendString(out, ": ");
+            }
+            out = appendString(out, record.message);
+        }
+        *out++ = '\n';
+        if ( write(fd, line, out - line) < 0 )
+        {
+            return;
+        }
+    }
+}
+
+void Logger::dump_recorder()
+{
+    if ( not g_recorder.dump_path[0] or g_recorder.dumped.exchange(true) ) // Only the first crash is of interest
+    {
+        return;
+    }
+    int fd = open(g_recorder.dump_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if ( fd >= 0 )
+    {
+        dump_recorder(fd);
+        close(fd);
+    }
+}
+
+static void crashHandler(int signal_number)
+{
+    Logger::dump_recorder();
+    std::signal(signal_number, SIG_DFL); // Lets the default action terminate the process, with a core dump if enabled
+    std::raise(signal_number);
+}
+
+void Logger::install_crash_handler(const char* dump_path)
+{
+    std::strncpy(g_recorder.dump_path, dump_path, sizeof(g_recorder.dump_path) - 1);
+    struct sigaction action {};
+    action.sa_handler = crashHandler;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESETHAND;
+    const int signals[] = {SIGSEGV, SIGABRT, SIGILL, SIGBUS, SIGFPE}; // SIGILL is what __builtin_trap raises on x86
+    for ( int signal_number : signals )
+    {
+        sigaction(signal_number, &action, nullptr);
+    }
+}
 
 void Logger::log(int level, const char* fmt, ...)
 {
-    if ( level >= LogLevel ) {
+    if ( is_enabled(CAT_GENERAL, level) )
+    {
         std::va_list args;
+        va_start(args, fmt);
+        logMessage(CAT_GENERAL, level, fmt, args);
+        va_end(args);
+    }
+}
 
-        std::time_t time_epox = std::time(nullptr);
-        std::tm*    time = std::localtime(&time_epox);
-        char        buf[16];
-        buf[strftime(buf, sizeof(buf), "%H:%M:%S", time)] = '\0';
-
-        fprintf(stderr, "%s [%-5s]: ", buf, level_strings[level]);
+void Logger::log_category(int category, int level, const char* fmt, ...)
+{
+    if ( is_enabled(category, level) )
+    {
+        std::va_list args;
         va_start(args, fmt);
-        vfprintf(stderr, fmt, args);
-        fprintf(stderr, "\n");
+        logMessage(category, level, fmt, args);
         va_end(args);
     }
 }
+
+void Logger::start(const char* binary_path)
+{
+    if ( g_ring.running.load() )
+    {
+        return;
+    }
+    if ( binary_path )
+    {
+        g_binary.file = std::fopen(binary_path, "wb");
+        if ( g_binary.file )
+        {
+            std::memset(g_binary.format_written, 0, sizeof(g_binary.format_written)); // Every file defines its formats
+            fwrite(LOG_BINARY_MAGIC, sizeof(char), sizeof(LOG_BINARY_MAGIC), g_binary.file);
+            fwrite(&LOG_BINARY_VERSION, sizeof(LOG_BINARY_VERSION), 1, g_binary.file);
+            g_binary.enabled.store(true);
+        }
+        else
+        {
+            fprintf(stderr, "Could not open binary log file %s. Logging as text\n", binary_path);
+        }
+    }
+    // Each slot is free for the next position that maps to it. Positions keep counting up across restarts
+    std::uint64_t enqueue_pos = g_ring.enqueue_pos.load();
+    for ( std::uint64_t pos = enqueue_pos; pos < enqueue_pos + LOG_RING_SIZE; pos++ )
+    {
+        g_ring.slots[pos & (LOG_RING_SIZE - 1)].sequence.store(pos, std::memory_order_relaxed);
+    }
+    g_ring.dequeue_pos = enqueue_pos;
+    g_ring.running.store(true, std::memory_order_release);
+    g_ring.writer = std::thread(writerLoop);
+
+    static bool registered = false;
+    if ( not registered )
+    {
+        std::atexit(Logger::stop); // Joins the writer even if the application does not stop it
+        registered = true;
+    }
+}
+
+void Logger::stop()
+{
+    if ( not g_ring.running.load() )
+    {
+        return;
+    }
+    // Binary mode is left first so that later messages take the text path, which does not need the writer. Otherwise
+    // a record enqueued after the last pass of the writer would be lost without being counted as dropped
+    g_binary.enabled.store(false, std::memory_order_release);
+    g_ring.running.store(false, std::memory_order_release);
+    g_ring.writer.join();
+    drainRing(); // Messages that were being enqueued while the writer stopped
+    fflush(stderr);
+    if ( g_binary.file )
+    {
+        std::fclose(g_binary.file);
+        g_binary.file = nullptr;
+    }
+}
+
+void Logger::flush()
+{
+    if ( not g_ring.running.load(std::memory_order_acquire) )
+    {
+        fflush(stderr);
+        return;
+    }
+    // Waits for the writer to catch up with everything published so far
+    std::uint64_t target = g_ring.enqueue_pos.load(std::memory_order_acquire);
+    while ( g_ring.running.load(std::memory_order_acquire) )
+    {
+        LogSlot& slot = g_ring.slots[(target - 1) & (LOG_RING_SIZE - 1)];
+        if ( target == 0 or slot.sequence.load(std::memory_order_acquire) >= target - 1 + LOG_RING_SIZE )
+        {
+            break;
+        }
+        std::this_thread::yield();
+    }
+    fflush(stderr);
+    if ( g_binary.enabled.load() )
+    {
+        fflush(g_binary.file);
+    }
+}
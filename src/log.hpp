@@ -3,29 +3,81 @@
 //  Define the LOGOFF macro to disable all logging when using the convenience macros. Useful if you are not
 //  interested at all in logging your application on a, e.g., release build
 //
+//  Messages belong to a category (parser, render, ...) with its own level. The compile-time minimum level of each
+//  category removes the calls under it altogether and the runtime level can be raised or lowered on top of it
+//
+//  A flight recorder keeps the last few hundred messages and frame markers in memory, including those under the
+//  output level down to the recorder level. It is dumped to a file when an LASSERT fails or the process crashes
+//
+//  After "start" messages are formatted into a lock-free ring buffer and written by a background thread, so logging
+//  never blocks on I/O. If the ring is full the message is dropped and the number of drops is reported.
+//  Before "start" or after "stop" messages are written synchronously.
+//  If "start" is given a file path the messages are not formatted at all. Only the format string ID, a timestamp and
+//  the raw arguments are written to it. See log_binary.hpp
+//
 
 #pragma once
 
 #include <cassert>
 
 #ifndef NDEBUG
-#    define LASSERT(cond, ...) if(!(cond)){Logger::log(Logger::LOG_ERROR, __VA_ARGS__); __builtin_trap();} // Not portable, only usable in linux
+#    define LASSERT(cond, ...) if(!(cond)){Logger::log(Logger::LOG_ERROR, __VA_ARGS__); Logger::flush(); Logger::dump_recorder(); __builtin_trap();} // Not portable, only usable in linux
 #else
 #    define LASSERT(...) (void)0
 #endif
 
 #ifndef LOGOFF
-#    define LTRACE(...) Logger::log(Logger::LOG_TRACE, __VA_ARGS__)
-#    define LDEBUG(...) Logger::log(Logger::LOG_DEBUG, __VA_ARGS__)
-#    define LINFO(...) Logger::log(Logger::LOG_INFO, __VA_ARGS__)
-#    define LWARN(...) Logger::log(Logger::LOG_WARN, __VA_ARGS__)
-#    define LERROR(...) Logger::log(Logger::LOG_ERROR, __VA_ARGS__)
+#    define LCLOG(category, level, ...)                                                                                \
+        do                                                                                                             \
+        {                                                                                                              \
+            if constexpr ( (level) >= Logger::CATEGORY_MIN_LEVEL[Logger::CAT_##category] )                            \
+            {                                                                                                          \
+                if ( Logger::is_enabled(Logger::CAT_##category, level) )                                               \
+                {                                                                                                      \
+                    Logger::log_category(Logger::CAT_##category, level, __VA_ARGS__);                                 \
+                }                                                                                                      \
+            }                                                                                                          \
+        } while ( 0 )
 #else
-#    define LTRACE(...) (void)0
-#    define LDEBUG(...) (void)0
-#    define LINFO(...) (void)0
-#    define LWARN(...) (void)0
-#    define LERROR(...) (void)0
+#    define LCLOG(...) (void)0
+#endif
+
+// Logging for a given category, e.g., LCDEBUG(PARSER, "Parsing %s", name). Messages under the compile-time minimum
+// level of the category are discarded without evaluating their arguments
+#define LCTRACE(category, ...) LCLOG(category, Logger::LOG_TRACE, __VA_ARGS__)
+#define LCDEBUG(category, ...) LCLOG(category, Logger::LOG_DEBUG, __VA_ARGS__)
+#define LCINFO(category, ...) LCLOG(category, Logger::LOG_INFO, __VA_ARGS__)
+#define LCWARN(category, ...) LCLOG(category, Logger::LOG_WARN, __VA_ARGS__)
+#define LCERROR(category, ...) LCLOG(category, Logger::LOG_ERROR, __VA_ARGS__)
+
+#define LTRACE(...) LCTRACE(GENERAL, __VA_ARGS__)
+#define LDEBUG(...) LCDEBUG(GENERAL, __VA_ARGS__)
+#define LINFO(...) LCINFO(GENERAL, __VA_ARGS__)
+#define LWARN(...) LCWARN(GENERAL, __VA_ARGS__)
+#define LERROR(...) LCERROR(GENERAL, __VA_ARGS__)
+
+// Compile-time minimum level of all categories. Each one can be overridden with its own LOG_MIN_LEVEL_<CATEGORY>
+#ifndef LOG_MIN_LEVEL
+#    ifndef NDEBUG
+#        define LOG_MIN_LEVEL 0 // LOG_TRACE
+#    else
+#        define LOG_MIN_LEVEL 2 // LOG_INFO
+#    endif
+#endif
+#ifndef LOG_MIN_LEVEL_GENERAL
+#    define LOG_MIN_LEVEL_GENERAL LOG_MIN_LEVEL
+#endif
+#ifndef LOG_MIN_LEVEL_PARSER
+#    define LOG_MIN_LEVEL_PARSER LOG_MIN_LEVEL
+#endif
+#ifndef LOG_MIN_LEVEL_RENDER
+#    define LOG_MIN_LEVEL_RENDER LOG_MIN_LEVEL
+#endif
+#ifndef LOG_MIN_LEVEL_INPUT
+#    define LOG_MIN_LEVEL_INPUT LOG_MIN_LEVEL
+#endif
+#ifndef LOG_MIN_LEVEL_ARENA
+#    define LOG_MIN_LEVEL_ARENA LOG_MIN_LEVEL
 #endif
 
 namespace Logger {
@@ -39,8 +91,41 @@ enum
     LOG_ERROR
 };
 
+enum Category
+{
+    CAT_GENERAL,
+    CAT_PARSER,
+    CAT_RENDER,
+    CAT_INPUT,
+    CAT_ARENA,
+    CAT_COUNT
+};
+
+constexpr int CATEGORY_MIN_LEVEL[CAT_COUNT] = {
+  LOG_MIN_LEVEL_GENERAL,
+  LOG_MIN_LEVEL_PARSER,
+  LOG_MIN_LEVEL_RENDER,
+  LOG_MIN_LEVEL_INPUT,
+  LOG_MIN_LEVEL_ARENA};
+
+extern int category_levels[CAT_COUNT]; // Runtime levels. Use "set_level" and "set_category_level" to modify them
+
+inline bool is_enabled(int category, int level) { return level >= category_levels[category]; }
+
 void log(int level, const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+void log_category(int category, int level, const char* fmt, ...) __attribute__((format(printf, 3, 4)));
+
+void set_level(int log_level); // sets the runtime level of all categories
+void set_category_level(int category, int log_level);
+
+void set_recorder_level(int log_level); // messages at or over this level are kept by the flight recorder
+void record_frame(long frame);          // adds a frame marker to the flight recorder
+void dump_recorder(int fd);             // writes the flight recorder contents. Safe to call from a signal handler
+void dump_recorder();                   // writes it to the crash handler path. Only the first call does anything
+void install_crash_handler(const char* dump_path); // dumps the flight recorder on SIGSEGV, SIGABRT, SIGILL, ...
 
-void set_level(int log_level);
+void start(const char* binary_path = nullptr); // starts the background writer. Writes binary records if a path is given
+void stop();  // writes the pending messages and joins the writer. Other threads should have stopped logging
+void flush(); // blocks until everything logged so far has been written
 
 }
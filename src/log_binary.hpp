@@ -0,0 +1,148 @@
+//
+//  Binary log format with deferred formatting
+//
+//  Instead of formatting the message, the logger writes the ID of its format string, a timestamp and the raw
+//  arguments. The first time a format string is used a definition record with its text is written as well, so the
+//  stream is self-contained. tools/logdecode.cpp turns it back into text.
+//
+//  All values are in native byte order:
+//    header:     "YLOG" u32 version
+//    definition: u8 LOG_RECORD_FORMAT  u16 id  u16 length  char text[length]
+//    message:    u8 LOG_RECORD_MESSAGE u8 level u8 category u16 id i64 time_ns u16 size  u8 args[size]
+//    drops:      u8 LOG_RECORD_DROPPED u64 count
+//  Arguments are i32, i64, f64 or u64 (pointers) values, strings are u16 length followed by the characters. Long doubles
+//  are narrowed to f64 and wide strings are converted to UTF-8, which the decoder prints as narrow strings
+//
+
+#pragma once
+
+#include <cstdint>
+
+const char          LOG_BINARY_MAGIC[4] = {'Y', 'L', 'O', 'G'};
+const std::uint32_t LOG_BINARY_VERSION = 2;
+const int           LOG_MAX_ARGS = 16; // Maximum number of arguments of a format string in binary mode
+
+enum LogRecordType
+{
+    LOG_RECORD_FORMAT = 1,
+    LOG_RECORD_MESSAGE = 2,
+    LOG_RECORD_DROPPED = 3,
+};
+
+enum LogArgType
+{
+    LOG_ARG_INT32,
+    LOG_ARG_INT64,
+    LOG_ARG_DOUBLE,
+    LOG_ARG_LONG_DOUBLE, // "%Lf" and the like. Read as long double but stored as a double
+    LOG_ARG_STRING,
+    LOG_ARG_STRING_PRECISION, // "%.*s" strings, which do not need to be NUL-terminated. Stored like other strings
+    LOG_ARG_WIDE_STRING,      // "%ls" and "%S". Stored as UTF-8
+    LOG_ARG_WIDE_STRING_PRECISION,
+    LOG_ARG_POINTER,
+};
+
+extern const char* level_strings[];
+extern const char* category_strings[];
+
+// A printf conversion specification and the arguments it consumes. "*" width and precision take an extra int each
+struct LogConversion
+{
+    const char* start; // points to the '%'
+    const char* end;   // one past the conversion character
+    int         num_args;
+    LogArgType  arg_types[3];
+};
+
+// Finds the next conversion that consumes arguments. Returns false if there are no more
+inline bool logNextConversion(const char* fmt, LogConversion& conversion)
+{
+    while ( *fmt )
+    {
+        if ( *fmt != '%' )
+        {
+            fmt++;
+            continue;
+        }
+        conversion.start = fmt;
+        conversion.num_args = 0;
+        fmt++;
+        if ( *fmt == '%' )
+        {
+            fmt++;
+            continue;
+        }
+
+        while ( *fmt == '-' or *fmt == '+' or *fmt == ' ' or *fmt == '#' or *fmt == '0' ) // flags
+        {
+            fmt++;
+        }
+        bool in_precision = false;
+        bool star_precision = false;
+        while ( (*fmt >= '0' and *fmt <= '9') or *fmt == '*' or (*fmt == '.' and not in_precision) ) // width.precision
+        {
+            if ( *fmt == '*' )
+            {
+                conversion.arg_types[conversion.num_args++] = LOG_ARG_INT32;
+                star_precision = in_precision;
+            }
+            in_precision |= *fmt == '.';
+            fmt++;
+        }
+
+        int  length = 0; // number of 'l' modifiers, or 2 for the 64-bit ones
+        bool long_double = false;
+        while ( *fmt == 'h' or *fmt == 'l' or *fmt == 'z' or *fmt == 'j' or *fmt == 't' or *fmt == 'L' or *fmt == 'q' )
+        {
+            length += (*fmt == 'h') ? 0 : (*fmt == 'l') ? 1 : 2;
+            long_double |= *fmt == 'L';
+            fmt++;
+        }
+
+        LogArgType type;
+        switch ( *fmt )
+        {
+        case 'd':
+        case 'i':
+        case 'u':
+        case 'x':
+        case 'X':
+        case 'o':
+            type = length ? LOG_ARG_INT64 : LOG_ARG_INT32;
+            break;
+        case 'c': // Both char and the wint_t of "%lc" are passed as 32-bit values
+            type = LOG_ARG_INT32;
+            break;
+        case 'f':
+        case 'F':
+        case 'e':
+        case 'E':
+        case 'g':
+        case 'G':
+        case 'a':
+        case 'A':
+            type = long_double ? LOG_ARG_LONG_DOUBLE : LOG_ARG_DOUBLE;
+            break;
+        case 's':
+        case 'S':
+            if ( length or *fmt == 'S' )
+            {
+                type = star_precision ? LOG_ARG_WIDE_STRING_PRECISION : LOG_ARG_WIDE_STRING;
+            }
+            else
+            {
+                type = star_precision ? LOG_ARG_STRING_PRECISION : LOG_ARG_STRING;
+            }
+            break;
+        case 'p':
+            type = LOG_ARG_POINTER;
+            break;
+        default: // Unsupported or malformed conversion. Treated as literal text
+            continue;
+        }
+        conversion.arg_types[conversion.num_args++] = type;
+        conversion.end = fmt + 1;
+        return true;
+    }
+    return false;
+}
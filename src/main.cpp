@@ -1,4 +1,6 @@
+#include "alloc_guard.hpp"
 #include "arena.hpp"
+#include "asset_pack.hpp"
 #include "control.hpp"
 #include "file_io.hpp"
 #include "font.hpp"
@@ -8,6 +10,8 @@
 
 #include <SDL2/SDL.h>
 #include <cmath>
+#include <cstdio>
+#include <cstring>
 #include <glad/gl.h>
 #include <stb/stb_image.h>
 
@@ -16,11 +20,27 @@ const char*      TITLE = "Unnamed title";
 const IVec2      RESOLUTION = RES_SUPER_NINTENDO;
 const int        RES_SCALING = 4;
 const IVec2      WINDOW_SIZE {RESOLUTION.x * RES_SCALING, RESOLUTION.y* RES_SCALING};
+const char*      ASSET_PACK_NAME = "assets.pack"; // Next to the executable. Built with "make assets"
 
 int main([[maybe_unused]] int argc, char* argv[])
 {
 
     // set_level(Logger::LOG_INFO);
+    const char* binary_log_path = nullptr; // Decode with tools/logdecode
+    const char* levels_path = nullptr;     // Played instead of the bundled levels. See "LoadLevelData"
+    for ( int idx = 1; idx < argc - 1; idx++ )
+    {
+        if ( std::strcmp(argv[idx], "--log-binary") == 0 )
+        {
+            binary_log_path = argv[idx + 1];
+        }
+        else if ( std::strcmp(argv[idx], "--levels") == 0 )
+        {
+            levels_path = argv[idx + 1];
+        }
+    }
+    Logger::start(binary_log_path);
+    Logger::install_crash_handler("crash.log");
     if ( SDL_Init(SDL_INIT_VIDEO | SDL_INIT_GAMECONTROLLER) < 0 )
     {
         LERROR("SDL error when initializing: %s", SDL_GetError());
@@ -46,25 +66,38 @@ int main([[maybe_unused]] int argc, char* argv[])
     SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
 
     int version = gladLoadGL((GLADloadfunc)SDL_GL_GetProcAddress);
-    LDEBUG("Loaded GL %d.%d", GLAD_VERSION_MAJOR(version), GLAD_VERSION_MINOR(version));
+    LCDEBUG(RENDER, "Loaded GL %d.%d", GLAD_VERSION_MAJOR(version), GLAD_VERSION_MINOR(version));
+
+    Arena      arena {GIGABYTES(1), ARENA_VIRTUAL};
+    FrameArena frame_arena {MEGABYTES(64)}; // transient data built during a frame, like the geometry of the level
+    Shader     shader;
+    Shader     shader_effect;
+    arena.set_name("main");
+
+    // Every asset is read in place from a single mapping, found through the executable and not the working directory
+    AssetPack assets {};
+    {
+        char* base_path = SDL_GetBasePath();
+        char  pack_path[4096];
+        std::snprintf(pack_path, sizeof(pack_path), "%s%s", base_path ? base_path : "", ASSET_PACK_NAME);
+        SDL_free(base_path);
+        if ( not assetPackOpen(assets, pack_path) )
+        {
+            LERROR("Could not open the asset pack %s. Run \"make assets\" to build it", pack_path);
+            return 1;
+        }
+    }
 
-    Arena  arena {MEGABYTES(1)};
-    Shader shader;
-    Shader shader_effect;
     {
-        arena.set_mark();
-        const char* shader_str_vert = fileRead("src/sprite.vert", arena);
-        const char* shader_str_frag = fileRead("src/sprite.frag", arena);
-        const char* shader_str_frag_effect = fileRead("src/sprite_effect.frag", arena);
-        shaderInit(shader, shader_str_vert, shader_str_frag);
-        shaderInit(shader_effect, shader_str_vert, shader_str_frag_effect);
-        arena.reset_to_mark();
+        StrView shader_vert = assetGet(assets, "sprite.vert");
+        shaderInit(shader, shader_vert, assetGet(assets, "sprite.frag"));
+        shaderInit(shader_effect, shader_vert, assetGet(assets, "sprite_effect.frag"));
     }
 
     FontData font_data {};
     GLuint   TEXTURE_FONT_ID;
     {
-        font_data.file_path = "assets/PressStart2P.ttf";
+        font_data.file = assetGet(assets, "PressStart2P.ttf");
         font_data.size = 8;
         font_data.atlas_width = 512;
         font_data.atlas_height = 512;
@@ -87,8 +120,9 @@ int main([[maybe_unused]] int argc, char* argv[])
     int    width, height;
     {
         int            nr_channels;
-        const char*    file = "assets/tiles.png";
-        unsigned char* data = stbi_load(file, &width, &height, &nr_channels, 0);
+        StrView        file = assetGet(assets, "tiles.png");
+        unsigned char* data = stbi_load_from_memory(
+          reinterpret_cast<const stbi_uc*>(file.data), (int)file.size, &width, &height, &nr_channels, 0);
 
         glGenTextures(1, &TEXTURE_ID);
         glBindTexture(GL_TEXTURE_2D, TEXTURE_ID);
@@ -125,7 +159,10 @@ int main([[maybe_unused]] int argc, char* argv[])
         glUniformMatrix4fv(mat_loc_proj, 1, GL_TRUE, &proje_mat[0][0]);
     }
 
-    LoadLevelData(arena);
+    if ( not LoadLevelData(arena, assetGet(assets, "levels.pack"), levels_path) )
+    {
+        return 1;
+    }
     GamepadState        keyboard {};
     Vec2                vel {};
     int                 movement_time_counter {};
@@ -133,7 +170,7 @@ int main([[maybe_unused]] int argc, char* argv[])
     bool                has_won {false};
     int                 current_level {};
     Registry            registry {};
-    EntityID            ent_id_player = LoadLevel(registry, font_data, current_level);
+    EntityID            ent_id_player = LoadLevel(registry, font_data, current_level, frame_arena.current());
     SDL_GameController* controller = ctrlFindController();
 
     glEnable(GL_BLEND);
@@ -143,14 +180,27 @@ int main([[maybe_unused]] int argc, char* argv[])
 
     SDL_Event event;
     bool      should_quit {false};
-    float       time {};
+    float     time {};
+    long      frame {};
     while ( not should_quit )
     {
+        allocGuardBegin(); // From here until the swap nothing should touch the heap, input included
 
         if ( time > 1e30f )
             time = 0.f;
         time+=0.017f;
 
+        if ( LevelDataChanged() )
+        {
+            allocGuardPause(); // Loading a level is allowed to allocate, so are the level changes below
+            if ( ReloadLevelData(arena, current_level) ) // The level being played was edited
+            {
+                CleanUp(registry);
+                ent_id_player = LoadLevel(registry, font_data, current_level, frame_arena.current());
+            }
+            allocGuardResume();
+        }
+
         while ( SDL_PollEvent(&event) )
         {
             switch ( event.type )
@@ -162,35 +212,45 @@ int main([[maybe_unused]] int argc, char* argv[])
                 switch ( event.key.keysym.sym )
                 {
                 case SDLK_F1: // Restart
+                    allocGuardPause();
                     CleanUp(registry);
-                    LoadLevelData(arena);
-                    ent_id_player = LoadLevel(registry, font_data, current_level);
+                    ReloadLevelData(arena, current_level);
+                    ent_id_player = LoadLevel(registry, font_data, current_level, frame_arena.current());
+                    allocGuardResume();
                     break;
                 case SDLK_F2: // Advance
+                    allocGuardPause();
                     CleanUp(registry);
                     current_level++;
-                    ent_id_player = LoadLevel(registry, font_data, current_level);
+                    ent_id_player = LoadLevel(registry, font_data, current_level, frame_arena.current());
+                    allocGuardResume();
                     break;
                 case SDLK_F3: // Start from the beggining
+                    allocGuardPause();
                     CleanUp(registry);
                     current_level = 0;
-                    ent_id_player = LoadLevel(registry, font_data, current_level);
+                    ent_id_player = LoadLevel(registry, font_data, current_level, frame_arena.current());
+                    allocGuardResume();
                     break;
                 }
                 break;
-            case SDL_CONTROLLERDEVICEADDED:
+            case SDL_CONTROLLERDEVICEADDED: // Opening and closing controllers is allowed to allocate
                 if ( !controller )
                 {
-                    LINFO("A new controller was connected with id %i", event.cdevice.which);
+                    LCINFO(INPUT, "A new controller was connected with id %i", event.cdevice.which);
+                    allocGuardPause();
                     controller = SDL_GameControllerOpen(event.cdevice.which);
+                    allocGuardResume();
                 }
                 break;
             case SDL_CONTROLLERDEVICEREMOVED:
-                LINFO("Controller was disconnected with id %i", event.cdevice.which);
+                LCINFO(INPUT, "Controller was disconnected with id %i", event.cdevice.which);
                 if ( controller && event.cdevice.which == SDL_JoystickInstanceID(SDL_GameControllerGetJoystick(controller)) )
                 {
+                    allocGuardPause();
                     SDL_GameControllerClose(controller);
                     controller = ctrlFindController();
+                    allocGuardResume();
                 }
                 break;
             }
@@ -339,7 +399,11 @@ int main([[maybe_unused]] int argc, char* argv[])
             }
         }
 
+        allocGuardEnd(frame);
         SDL_GL_SwapWindow(window);
+        frame_arena.flip();
+        frame++;
+        Logger::record_frame(frame);
 
         if ( has_won )
         {
@@ -347,7 +411,7 @@ int main([[maybe_unused]] int argc, char* argv[])
             CleanUp(registry);
             current_level++;
             has_won = false;
-            ent_id_player = LoadLevel(registry, font_data, current_level);
+            ent_id_player = LoadLevel(registry, font_data, current_level, frame_arena.current());
         }
     }
 
@@ -358,4 +422,7 @@ int main([[maybe_unused]] int argc, char* argv[])
     SDL_DestroyWindow(window);
     SDL_GL_DeleteContext(gl_context);
     SDL_Quit();
+    ReleaseLevelData();
+    assetPackClose(assets);
+    Logger::stop();
 }
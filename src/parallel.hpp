@@ -0,0 +1,144 @@
+//
+//  Fork-join helper for splitting work over the cores
+//
+//  The calling thread takes jobs as well and the call returns once every job has finished. Jobs are taken in order
+//  from a shared counter, so uneven jobs still keep every thread busy.
+//
+//  The worker threads are created on first use and then sleep between calls, so repeated calls, like the ones of
+//  every hot reload, do not pay for creating threads and keep the scratch arenas of the workers (see
+//  arena_thread.hpp). Calls made from inside a job, or while another thread is running a call, run their jobs on the
+//  calling thread instead
+//
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+
+const int PARALLEL_MAX_THREADS = 64;
+
+inline int parallelNumThreads()
+{
+    return std::clamp<int>(std::thread::hardware_concurrency(), 1, PARALLEL_MAX_THREADS);
+}
+
+struct ParallelPool
+{
+    std::mutex              batch_mutex; // held by the thread running the current call
+    std::mutex              mutex;       // guards everything below
+    std::condition_variable wake;        // workers wait here for the next call
+    std::condition_variable done;        // the caller waits here for the workers to finish
+    std::thread             threads[PARALLEL_MAX_THREADS];
+    int                     num_threads = 0;
+    bool                    stopping = false;
+
+    // The current call
+    std::uint64_t    generation = 0;
+    void             (*run)(void* job, int idx) = nullptr;
+    void*            job = nullptr;
+    int              num_jobs = 0;
+    int              num_workers = 0; // workers taking part, the first ones of "threads"
+    int              num_busy = 0;    // of those, the ones that have not finished yet
+    std::atomic<int> next_job {0};
+
+    ~ParallelPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock {mutex};
+            stopping = true;
+        }
+        wake.notify_all();
+        for ( int idx = 0; idx < num_threads; idx++ )
+        {
+            threads[idx].join();
+        }
+    }
+};
+
+inline thread_local bool t_parallel_busy = false; // whether the thread is a worker or is running a call
+
+inline ParallelPool& parallelPool()
+{
+    static ParallelPool pool; // Joined at exit
+    return pool;
+}
+
+inline void parallelRunJobs(ParallelPool& pool)
+{
+    for ( int idx = pool.next_job.fetch_add(1); idx < pool.num_jobs; idx = pool.next_job.fetch_add(1) )
+    {
+        pool.run(pool.job, idx);
+    }
+}
+
+inline void parallelWorker(ParallelPool& pool, int worker)
+{
+    std::uint64_t                seen = 0;
+    std::unique_lock<std::mutex> lock {pool.mutex};
+    t_parallel_busy = true;
+    while ( true )
+    {
+        pool.wake.wait(lock, [&] { return pool.stopping or pool.generation != seen; });
+        if ( pool.stopping )
+        {
+            return;
+        }
+        seen = pool.generation;
+        if ( worker >= pool.num_workers ) // Not needed for this call
+        {
+            continue;
+        }
+        lock.unlock();
+        parallelRunJobs(pool);
+        lock.lock();
+        if ( --pool.num_busy == 0 )
+        {
+            pool.done.notify_one();
+        }
+    }
+}
+
+// Runs "job(idx)" for every index in [0, num_jobs)
+template<typename F>
+void parallelFor(int num_jobs, F&& job)
+{
+    ParallelPool&                pool = parallelPool();
+    int                          num_workers = std::min(num_jobs, parallelNumThreads()) - 1;
+    std::unique_lock<std::mutex> batch {pool.batch_mutex, std::defer_lock};
+    if ( num_workers <= 0 or t_parallel_busy or not batch.try_lock() )
+    {
+        for ( int idx = 0; idx < num_jobs; idx++ )
+        {
+            job(idx);
+        }
+        return;
+    }
+
+    using Job = std::remove_reference_t<F>;
+    {
+        std::lock_guard<std::mutex> lock {pool.mutex};
+        for ( ; pool.num_threads < num_workers; pool.num_threads++ )
+        {
+            pool.threads[pool.num_threads] = std::thread {parallelWorker, std::ref(pool), pool.num_threads};
+        }
+        pool.run = [](void* job, int idx) { (*static_cast<Job*>(job))(idx); };
+        pool.job = const_cast<void*>(static_cast<const void*>(&job));
+        pool.num_jobs = num_jobs;
+        pool.num_workers = num_workers;
+        pool.num_busy = num_workers;
+        pool.next_job.store(0, std::memory_order_relaxed);
+        pool.generation++;
+    }
+    pool.wake.notify_all();
+    t_parallel_busy = true;
+    parallelRunJobs(pool);
+    t_parallel_busy = false;
+
+    std::unique_lock<std::mutex> lock {pool.mutex};
+    pool.done.wait(lock, [&] { return pool.num_busy == 0; });
+}
@@ -0,0 +1,127 @@
+//
+//  Fixed-size pool of objects with an intrusive free list
+//
+//  Slots live in a single contiguous array and are handed out by index. Released slots are zeroed and pushed on a
+//  free list, so allocating and releasing are O(1) and slots are reused before the pool grows any further.
+//  "size" is one past the highest slot ever used, which bounds loops over the raw array
+//
+
+#pragma once
+
+#include "log.hpp"
+
+#include <cstring>
+#include <type_traits>
+
+const int POOL_INVALID = -1;
+
+template<typename T, int N>
+class Pool
+{
+    static_assert(std::is_trivially_copyable<T>::value, "Pool slots are reset with memset");
+
+  public:
+    class Iterator // Iterates over the live slots only
+    {
+      public:
+        Iterator(Pool& pool, int idx) : m_pool {pool}, m_idx {idx} { skip_dead(); }
+        T&        operator*() { return m_pool.m_items[m_idx]; }
+        Iterator& operator++()
+        {
+            m_idx++;
+            skip_dead();
+            return *this;
+        }
+        bool operator!=(const Iterator& other) const { return m_idx != other.m_idx; }
+
+      private:
+        void skip_dead()
+        {
+            while ( m_idx < m_pool.m_size and not m_pool.is_live(m_idx) )
+            {
+                m_idx++;
+            }
+        }
+
+        Pool& m_pool;
+        int   m_idx;
+    };
+
+    Pool();
+    int      alloc();         // returns the index of a zeroed slot or POOL_INVALID if the pool is full
+    void     free(int idx);   // zeroes the slot and puts it back on the free list
+    void     clear();         // releases every slot at once
+    bool     is_live(int idx) const { return m_next_free[idx] == SLOT_LIVE; }
+    int      size() const { return m_size; }
+    int      num_live() const { return m_num_live; }
+    T*       data() { return m_items; }
+    T&       operator[](int idx);
+    Iterator begin() { return Iterator {*this, 0}; }
+    Iterator end() { return Iterator {*this, m_size}; }
+
+  private:
+    static const int SLOT_LIVE = -2;
+
+    T   m_items[N];
+    int m_next_free[N]; // next slot on the free list or SLOT_LIVE if the slot is in use
+    int m_free_head;
+    int m_size;
+    int m_num_live;
+};
+
+template<typename T, int N>
+Pool<T, N>::Pool()
+{
+    std::memset(m_items, 0, sizeof(m_items));
+    m_free_head = POOL_INVALID;
+    m_size = 0;
+    m_num_live = 0;
+}
+
+template<typename T, int N>
+int Pool<T, N>::alloc()
+{
+    int idx = m_free_head;
+    if ( idx != POOL_INVALID )
+    {
+        m_free_head = m_next_free[idx];
+    }
+    else if ( m_size < N )
+    {
+        idx = m_size;
+        m_size++;
+    }
+    else
+    {
+        return POOL_INVALID;
+    }
+    m_next_free[idx] = SLOT_LIVE;
+    m_num_live++;
+    return idx;
+}
+
+template<typename T, int N>
+void Pool<T, N>::free(int idx)
+{
+    LASSERT(idx >= 0 and idx < m_size and is_live(idx), "Releasing invalid pool slot %i", idx);
+    std::memset(&m_items[idx], 0, sizeof(T));
+    m_next_free[idx] = m_free_head;
+    m_free_head = idx;
+    m_num_live--;
+}
+
+template<typename T, int N>
+void Pool<T, N>::clear()
+{
+    std::memset(m_items, 0, m_size * sizeof(T)); // Slots past the size have never been touched
+    m_free_head = POOL_INVALID;
+    m_size = 0;
+    m_num_live = 0;
+}
+
+template<typename T, int N>
+T& Pool<T, N>::operator[](int idx)
+{
+    LASSERT(idx >= 0 and idx < m_size, "Invalid pool slot %i. Pool size is %i", idx, m_size);
+    return m_items[idx];
+}
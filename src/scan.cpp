@@ -0,0 +1,140 @@
+#include "scan.hpp"
+
+#include "log.hpp"
+
+#include <cstring>
+
+#if defined(__x86_64__)
+#    include <immintrin.h>
+#endif
+
+typedef void (*ScanBlocksFn)(const char* data, std::int64_t num_blocks, const ScanSet& set, std::uint64_t* masks);
+
+static std::uint64_t scanBlockScalar(const char* data, std::int64_t size, const ScanSet& set)
+{
+    std::uint64_t mask = 0;
+    for ( std::int64_t idx = 0; idx < size; idx++ )
+    {
+        for ( int char_idx = 0; char_idx < set.num_chars; char_idx++ )
+        {
+            if ( data[idx] == set.chars[char_idx] )
+            {
+                mask |= 1ULL << idx;
+                break;
+            }
+        }
+    }
+    return mask;
+}
+
+#if not defined(__x86_64__)
+static void scanBlocksScalar(const char* data, std::int64_t num_blocks, const ScanSet& set, std::uint64_t* masks)
+{
+    for ( std::int64_t block = 0; block < num_blocks; block++ )
+    {
+        masks[block] = scanBlockScalar(data + block * SCAN_BLOCK_SIZE, SCAN_BLOCK_SIZE, set);
+    }
+}
+#else
+static void scanBlocksSse2(const char* data, std::int64_t num_blocks, const ScanSet& set, std::uint64_t* masks)
+{
+    __m128i needles[SCAN_MAX_CHARS];
+    for ( int char_idx = 0; char_idx < set.num_chars; char_idx++ )
+    {
+        needles[char_idx] = _mm_set1_epi8(set.chars[char_idx]);
+    }
+
+    for ( std::int64_t block = 0; block < num_blocks; block++ )
+    {
+        std::uint64_t mask = 0;
+        for ( int part = 0; part < SCAN_BLOCK_SIZE / 16; part++ )
+        {
+            __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + block * SCAN_BLOCK_SIZE + part * 16));
+            __m128i found = _mm_setzero_si128();
+            for ( int char_idx = 0; char_idx < set.num_chars; char_idx++ )
+            {
+                found = _mm_or_si128(found, _mm_cmpeq_epi8(bytes, needles[char_idx]));
+            }
+            mask |= static_cast<std::uint64_t>(static_cast<std::uint16_t>(_mm_movemask_epi8(found))) << (part * 16);
+        }
+        masks[block] = mask;
+    }
+}
+
+__attribute__((target("avx2"))) static void scanBlocksAvx2(const char* data, std::int64_t num_blocks, const ScanSet& set, std::uint64_t* masks)
+{
+    __m256i needles[SCAN_MAX_CHARS];
+    for ( int char_idx = 0; char_idx < set.num_chars; char_idx++ )
+    {
+        needles[char_idx] = _mm256_set1_epi8(set.chars[char_idx]);
+    }
+
+    for ( std::int64_t block = 0; block < num_blocks; block++ )
+    {
+        const char* ptr = data + block * SCAN_BLOCK_SIZE;
+        __m256i     low = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ptr));
+        __m256i     high = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ptr + 32));
+        __m256i     found_low = _mm256_setzero_si256();
+        __m256i     found_high = _mm256_setzero_si256();
+        for ( int char_idx = 0; char_idx < set.num_chars; char_idx++ )
+        {
+            found_low = _mm256_or_si256(found_low, _mm256_cmpeq_epi8(low, needles[char_idx]));
+            found_high = _mm256_or_si256(found_high, _mm256_cmpeq_epi8(high, needles[char_idx]));
+        }
+        masks[block] = static_cast<std::uint32_t>(_mm256_movemask_epi8(found_low)) |
+                       static_cast<std::uint64_t>(static_cast<std::uint32_t>(_mm256_movemask_epi8(found_high))) << 32;
+    }
+}
+#endif
+
+struct ScanImplementation
+{
+    ScanBlocksFn scan_blocks;
+    const char*  name;
+};
+
+static ScanImplementation scanSelectImplementation()
+{
+#if defined(__x86_64__)
+    ScanImplementation implementation = {scanBlocksSse2, "sse2"};
+    if ( __builtin_cpu_supports("avx2") )
+    {
+        implementation = {scanBlocksAvx2, "avx2"};
+    }
+#else
+    ScanImplementation implementation = {scanBlocksScalar, "scalar"};
+#endif
+    LDEBUG("Character scanning uses %s", implementation.name);
+    return implementation;
+}
+
+// Selected on first use. Thread-safe through the static initialization
+static const ScanImplementation& scanImplementation()
+{
+    static const ScanImplementation implementation = scanSelectImplementation();
+    return implementation;
+}
+
+ScanSet scanSet(const char* chars)
+{
+    ScanSet set {};
+    set.num_chars = std::strlen(chars);
+    LASSERT(set.num_chars <= SCAN_MAX_CHARS, "Scan sets are limited to %i characters: %s", SCAN_MAX_CHARS, chars);
+    std::memcpy(set.chars, chars, set.num_chars);
+    return set;
+}
+
+const char* scanImplementationName()
+{
+    return scanImplementation().name;
+}
+
+void scanClassify(const char* data, std::int64_t size, const ScanSet& set, std::uint64_t* masks)
+{
+    std::int64_t num_blocks = size / SCAN_BLOCK_SIZE;
+    scanImplementation().scan_blocks(data, num_blocks, set, masks);
+    if ( size % SCAN_BLOCK_SIZE ) // The tail is not padded so it cannot be loaded with vector instructions
+    {
+        masks[num_blocks] = scanBlockScalar(data + num_blocks * SCAN_BLOCK_SIZE, size % SCAN_BLOCK_SIZE, set);
+    }
+}
@@ -0,0 +1,26 @@
+//
+//  Vectorized search of a small set of characters
+//
+//  The input is classified 64 bytes at a time into bit masks, bit N of mask M being set if the byte at 64 * M + N is
+//  one of the characters of the set. Iterating the set bits visits only the interesting bytes, in order.
+//  Uses AVX2 when the CPU supports it, otherwise SSE2 on x86-64 and plain loops anywhere else
+//
+
+#pragma once
+
+#include <cstdint>
+
+const int SCAN_BLOCK_SIZE = 64;
+const int SCAN_MAX_CHARS = 16;
+
+struct ScanSet
+{
+    char chars[SCAN_MAX_CHARS];
+    int  num_chars;
+};
+
+ScanSet     scanSet(const char* chars); // builds the set from the characters of a NUL-terminated string
+const char* scanImplementationName();
+
+// Writes (size + 63) / 64 masks. The input does not need any padding
+void scanClassify(const char* data, std::int64_t size, const ScanSet& set, std::uint64_t* masks);
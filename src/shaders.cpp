@@ -4,7 +4,7 @@
 
 #include <cstdio>
 
-void shaderInit(Shader& shader, const char* vertex_shader_str, const char* fragment_shader_str)
+void shaderInit(Shader& shader, StrView vertex_shader_src, StrView fragment_shader_src)
 {
     GLuint shader_program = glCreateProgram();
     shader.program_id = shader_program;
@@ -14,21 +14,22 @@ void shaderInit(Shader& shader, const char* vertex_shader_str, const char* fragm
     while ( index < 2 )
     {
         // Create shader in open GL and compile
-        GLuint      gl_shader;
-        const char* shader_str;
+        GLuint  gl_shader;
+        StrView shader_src;
 
         if ( index == 0 )
         {
-            shader_str = vertex_shader_str;
+            shader_src = vertex_shader_src;
             gl_shader = glCreateShader(GL_VERTEX_SHADER);
         }
         else
         {
-            shader_str = fragment_shader_str;
+            shader_src = fragment_shader_src;
             gl_shader = glCreateShader(GL_FRAGMENT_SHADER);
         }
 
-        glShaderSource(gl_shader, 1, &shader_str, NULL);
+        GLint length = shader_src.size;
+        glShaderSource(gl_shader, 1, &shader_src.data, &length);
         glCompileShader(gl_shader);
 
         // check for shader compile errors
@@ -37,7 +38,7 @@ void shaderInit(Shader& shader, const char* vertex_shader_str, const char* fragm
         if ( not success )
         {
             glGetShaderInfoLog(gl_shader, 512, nullptr, info_log_buffer);
-            LERROR("Shader compilation failed for shader type %i:  %s", index, info_log_buffer);
+            LCERROR(RENDER, "Shader compilation failed for shader type %i:  %s", index, info_log_buffer);
         }
         glAttachShader(shader_program, gl_shader);
         glDeleteShader(gl_shader); // flagd for deletion
@@ -52,7 +53,7 @@ void shaderInit(Shader& shader, const char* vertex_shader_str, const char* fragm
     if ( not success )
     {
         glGetProgramInfoLog(shader_program, 512, NULL, info_log_buffer);
-        LERROR("Shader linking failed: %s", info_log_buffer);
+        LCERROR(RENDER, "Shader linking failed: %s", info_log_buffer);
     }
 }
 
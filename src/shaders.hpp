@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include "file_io.hpp"
 
 #include <glad/gl.h>
 
@@ -12,6 +13,7 @@ struct Shader
     GLuint program_id; // Make the paths part of the shader and perhaps initialize them passing the arena.
 };
 
-void shaderInit(Shader& shader_program, const char* vertex_shader_path, const char* fragmen_shader_path);
+// The sources do not need to be NUL-terminated, so they can point straight into a mapped file
+void shaderInit(Shader& shader_program, StrView vertex_shader_src, StrView fragment_shader_src);
 
 
@@ -0,0 +1,118 @@
+//
+//  Checks of the arena allocator. Built and run with "make test"
+//
+
+#include "arena.hpp"
+#include "arena_array.hpp"
+
+#include <cstdio>
+
+static int g_num_failed = 0;
+
+#define CHECK(cond)                                                                                                    \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        if ( not(cond) )                                                                                               \
+        {                                                                                                              \
+            std::fprintf(stderr, "%s:%i: check failed: %s\n", __FILE__, __LINE__, #cond);                             \
+            g_num_failed++;                                                                                            \
+        }                                                                                                              \
+    } while ( 0 )
+
+static void testExtendInPlace()
+{
+    Arena arena {KILOBYTES(64)};
+    int*  values = arena.allocate<int>(4);
+    int*  extended = arena.extend(values, 4, 8);
+    CHECK(extended == values);
+
+    arena.set_mark();
+    int* scratch = arena.allocate<int>(4);
+    CHECK(arena.extend(scratch, 4, 8) == scratch); // Allocated after the mark, so it can still grow in place
+    arena.reset_to_mark();
+}
+
+// An allocation made before a mark and grown after it must not be released with the mark
+static void testExtendAcrossMark()
+{
+    Arena arena {KILOBYTES(64)};
+    int*  values = arena.allocate<int>(4);
+    for ( int idx = 0; idx < 4; idx++ )
+    {
+        values[idx] = idx;
+    }
+
+    arena.set_mark();
+    values = arena.extend(values, 4, 8);
+    for ( int idx = 4; idx < 8; idx++ )
+    {
+        values[idx] = idx;
+    }
+    arena.reset_to_mark();
+
+    int* other = arena.allocate<int>(16);
+    for ( int idx = 0; idx < 16; idx++ )
+    {
+        other[idx] = -1;
+    }
+    for ( int idx = 0; idx < 8; idx++ )
+    {
+        CHECK(values[idx] == idx);
+    }
+}
+
+static void testExtendAcrossScope()
+{
+    Arena arena {KILOBYTES(64), ARENA_VIRTUAL};
+    char* text = arena.allocate<char>(3);
+    text[0] = 'a';
+    text[1] = 'b';
+    text[2] = 'c';
+    {
+        ArenaScope scope {arena};
+        text = arena.extend(text, 3, 4);
+        text[3] = 'd';
+    }
+    char* other = arena.allocate<char>(8);
+    std::memset(other, 'x', 8);
+    CHECK(std::memcmp(text, "abcd", 4) == 0);
+}
+
+// An array with storage from before a scope keeps what was pushed inside it
+static void testArrayAcrossScope()
+{
+    Arena           arena {MEGABYTES(1), ARENA_VIRTUAL};
+    ArenaArray<int> values {arena, 4};
+    {
+        ArenaScope scope {arena};
+        for ( int idx = 0; idx < 100; idx++ )
+        {
+            values.push(idx);
+        }
+    }
+    ArenaArray<int> other {arena};
+    for ( int idx = 0; idx < 100; idx++ )
+    {
+        other.push(-1);
+    }
+    CHECK(values.size() == 100);
+    for ( int idx = 0; idx < values.size(); idx++ )
+    {
+        CHECK(values[idx] == idx);
+    }
+}
+
+int main()
+{
+    testExtendInPlace();
+    testExtendAcrossMark();
+    testExtendAcrossScope();
+    testArrayAcrossScope();
+    if ( g_num_failed )
+    {
+        std::fprintf(stderr, "arena_test: %i checks failed\n", g_num_failed);
+        return 1;
+    }
+    std::printf("arena_test: all checks passed\n");
+    return 0;
+}
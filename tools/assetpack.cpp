@@ -0,0 +1,37 @@
+//
+//  Bundles the assets of the game into an asset pack. See src/asset_pack.hpp
+//
+//  Usage: assetpack <output pack> <files...>
+//  Each asset is named after its file without the directory
+//
+
+#include "asset_pack.hpp"
+#include "log.hpp"
+
+#include <cstdio>
+
+int main(int argc, char* argv[])
+{
+    if ( argc < 3 )
+    {
+        std::fprintf(stderr, "Usage: %s <output pack> <files...>\n", argv[0]);
+        return 1;
+    }
+
+    Arena   arena {GIGABYTES(1), ARENA_VIRTUAL};
+    Arena   scratch {GIGABYTES(1), ARENA_VIRTUAL};
+    StrView pack = assetPackBuild(argv + 2, argc - 2, arena, scratch);
+    if ( not pack.data )
+    {
+        LERROR("Could not bundle the assets into %s", argv[1]);
+        return 1;
+    }
+
+    if ( fileWrite(argv[1], (unsigned char*)pack.data, pack.size) != pack.size )
+    {
+        LERROR("Could not write the asset pack %s", argv[1]);
+        return 1;
+    }
+    LINFO("Bundled %i assets into %s (%li bytes)", argc - 2, argv[1], pack.size);
+    return 0;
+}
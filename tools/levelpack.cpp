@@ -0,0 +1,61 @@
+//
+//  Compiles the text level format into a level pack. See src/level.hpp
+//
+//  Usage: levelpack <levels text file> <output pack>
+//  With "-" as the input the levels are streamed from stdin, so generators and filters can be piped in
+//  Fails if any level is not valid, so broken levels do not silently disappear from the game. Duplicated levels are
+//  reported
+//
+
+#include "level.hpp"
+#include "log.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <unistd.h>
+
+int main(int argc, char* argv[])
+{
+    if ( argc != 3 )
+    {
+        std::fprintf(stderr, "Usage: %s <levels text file> <output pack>\n", argv[0]);
+        return 1;
+    }
+
+    Arena   arena {GIGABYTES(1), ARENA_VIRTUAL};
+    Arena   scratch {GIGABYTES(1), ARENA_VIRTUAL};
+    int     num_invalid = 0;
+    StrView pack;
+    if ( std::strcmp(argv[1], "-") == 0 )
+    {
+        pack = levelPackBuildStream(STDIN_FILENO, arena, scratch, num_invalid);
+    }
+    else
+    {
+        FileView text = fileMap(argv[1]);
+        if ( not text.data )
+        {
+            return 1;
+        }
+        pack = levelPackBuild({text.data, text.size}, arena, scratch, num_invalid);
+        fileUnmap(text);
+    }
+    if ( not pack.data or num_invalid )
+    {
+        LERROR("Could not compile %s: %i levels are not valid", argv[1], num_invalid);
+        return 1;
+    }
+
+    if ( fileWrite(argv[2], (unsigned char*)pack.data, pack.size) != pack.size )
+    {
+        LERROR("Could not write the level pack %s", argv[2]);
+        return 1;
+    }
+    // Copies, rotated and mirrored ones included, are reported but kept so the level numbers do not shift
+    LevelSet set {};
+    levelSetAttachPack(set, pack);
+    LevelHashIndex index {scratch, set.num_levels};
+    int            num_copies = levelHashIndexBuild(set, index);
+    LINFO("Compiled %i levels into %s (%li bytes). %i are copies", set.num_levels, argv[2], pack.size, num_copies);
+    return 0;
+}
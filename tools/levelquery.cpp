@@ -0,0 +1,180 @@
+//
+//  Lists the levels that match a query over their metadata. See LevelMetaTable in src/level.hpp
+//
+//  Usage: levelquery <levels text, pack or XSB collection> [--width min:max] [--height min:max] [--boxes min:max]
+//                    [--floor min:max] [--difficulty min:max] [--sort width|height|boxes|floor|difficulty]
+//  Either end of a range can be left out, so "--boxes 4:" keeps the levels with 4 boxes or more. Prints one line per
+//  level: its number, the metadata and the name
+//
+
+#include "level.hpp"
+#include "log.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+static bool endsWith(const char* str, const char* suffix)
+{
+    std::size_t length = std::strlen(str);
+    std::size_t suffix_length = std::strlen(suffix);
+    return length >= suffix_length and std::strcmp(str + length - suffix_length, suffix) == 0;
+}
+
+static bool parseRange(const char* arg, LevelMetaRange& range)
+{
+    const char* colon = std::strchr(arg, ':');
+    if ( not colon )
+    {
+        return false;
+    }
+    if ( colon != arg )
+    {
+        range.min = std::atoi(arg);
+    }
+    if ( colon[1] )
+    {
+        range.max = std::atoi(colon + 1);
+    }
+    return true;
+}
+
+struct QueryColumn
+{
+    const char*     option;
+    LevelMetaColumn column;
+};
+
+static const QueryColumn QUERY_COLUMNS[] = {
+    {"width", LEVEL_META_WIDTH},
+    {"height", LEVEL_META_HEIGHT},
+    {"boxes", LEVEL_META_BOXES},
+    {"floor", LEVEL_META_FLOOR_AREA},
+    {"difficulty", LEVEL_META_DIFFICULTY},
+};
+
+static LevelMetaRange* filterRange(LevelMetaFilter& filter, LevelMetaColumn column)
+{
+    switch ( column )
+    {
+    case LEVEL_META_WIDTH:
+        return &filter.width;
+    case LEVEL_META_HEIGHT:
+        return &filter.height;
+    case LEVEL_META_BOXES:
+        return &filter.num_boxes;
+    case LEVEL_META_FLOOR_AREA:
+        return &filter.floor_area;
+    case LEVEL_META_DIFFICULTY:
+        return &filter.difficulty;
+    }
+    return nullptr;
+}
+
+static const QueryColumn* findColumn(const char* name)
+{
+    for ( const QueryColumn& column : QUERY_COLUMNS )
+    {
+        if ( std::strcmp(column.option, name) == 0 )
+        {
+            return &column;
+        }
+    }
+    return nullptr;
+}
+
+int main(int argc, char* argv[])
+{
+    const char* usage = "Usage: %s <levels text, pack or XSB collection> [--width min:max] [--height min:max] "
+                        "[--boxes min:max] [--floor min:max] [--difficulty min:max] [--sort column]\n";
+    if ( argc < 2 )
+    {
+        std::fprintf(stderr, usage, argv[0]);
+        return 1;
+    }
+
+    LevelMetaFilter filter;
+    bool            sort = false;
+    LevelMetaColumn sort_column = LEVEL_META_WIDTH;
+    for ( int arg = 2; arg < argc; arg++ )
+    {
+        const QueryColumn* column = nullptr;
+        if ( std::strncmp(argv[arg], "--", 2) == 0 )
+        {
+            column = findColumn(argv[arg] + 2);
+        }
+        bool is_sort = std::strcmp(argv[arg], "--sort") == 0;
+        if ( (not column and not is_sort) or arg + 1 == argc )
+        {
+            std::fprintf(stderr, usage, argv[0]);
+            return 1;
+        }
+        arg++;
+        if ( is_sort )
+        {
+            const QueryColumn* sort_by = findColumn(argv[arg]);
+            if ( not sort_by )
+            {
+                std::fprintf(stderr, "Unknown column %s\n", argv[arg]);
+                return 1;
+            }
+            sort = true;
+            sort_column = sort_by->column;
+        }
+        else if ( not parseRange(argv[arg], *filterRange(filter, column->column)) )
+        {
+            std::fprintf(stderr, "Ranges are written min:max, not %s\n", argv[arg]);
+            return 1;
+        }
+    }
+
+    Arena    arena {GIGABYTES(1), ARENA_VIRTUAL};
+    Arena    scratch {GIGABYTES(1), ARENA_VIRTUAL};
+    LevelSet set {};
+    bool     loaded;
+    if ( endsWith(argv[1], ".xsb") or endsWith(argv[1], ".sok") )
+    {
+        loaded = levelSetLoadXsb(set, argv[1]);
+    }
+    else if ( endsWith(argv[1], ".pack") )
+    {
+        loaded = levelSetLoad(set, argv[1], "", scratch);
+    }
+    else
+    {
+        loaded = levelSetLoad(set, "", argv[1], scratch);
+    }
+    if ( not loaded )
+    {
+        LERROR("Could not load the levels of %s", argv[1]);
+        return 1;
+    }
+
+    LevelMetaTable table = levelMetaTable(set, arena);
+    int*           levels = arena.allocate<int>(table.num_levels);
+    int            count = levelMetaFilter(table, filter, levels);
+    if ( sort )
+    {
+        levelMetaSort(table, sort_column, levels, count);
+    }
+
+    for ( int idx = 0; idx < count; idx++ )
+    {
+        int     level = levels[idx];
+        StrView name = levelName(set, level);
+        std::printf("%6i  %2ix%-2i  boxes %3i  floor %3i  ", level, table.width[level], table.height[level],
+                    table.num_boxes[level], table.floor_area[level]);
+        if ( table.difficulty[level] == LEVEL_DIFFICULTY_UNKNOWN )
+        {
+            std::printf("difficulty   -  ");
+        }
+        else
+        {
+            std::printf("difficulty %3i  ", table.difficulty[level]);
+        }
+        std::printf("%.*s\n", (int)name.size, name.data);
+    }
+    LINFO("%i of %i levels match", count, table.num_levels);
+    levelSetRelease(set);
+    return 0;
+}
@@ -0,0 +1,330 @@
+//
+//  Turns a binary log written with "Logger::start(path)" back into text
+//
+//  Usage: logdecode <file>
+//  The definitions of the format strings are collected in a first pass, so a message can be decoded even if its
+//  definition comes later in the file. Each conversion is formatted on its own with snprintf
+//
+
+#include "log.hpp"
+#include "log_binary.hpp"
+
+#include <clocale>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+
+const int MAX_FORMATS = 65536;
+
+struct Reader
+{
+    const char* data;
+    long        size;
+    long        pos;
+};
+
+template<typename T>
+static bool readValue(Reader& reader, T& value)
+{
+    if ( reader.pos + (long)sizeof(T) > reader.size )
+    {
+        return false;
+    }
+    std::memcpy(&value, reader.data + reader.pos, sizeof(T));
+    reader.pos += sizeof(T);
+    return true;
+}
+
+static char* readFile(const char* path, long& size)
+{
+    std::FILE* file = std::fopen(path, "rb");
+    if ( not file )
+    {
+        return nullptr;
+    }
+    std::fseek(file, 0, SEEK_END);
+    size = std::ftell(file);
+    std::fseek(file, 0, SEEK_SET);
+    char* data = static_cast<char*>(std::malloc(size));
+    size = std::fread(data, 1, size, file);
+    std::fclose(file);
+    return data;
+}
+
+// Copies the text between two conversions, collapsing the "%%" escapes
+static void writeLiteral(const char* start, const char* end)
+{
+    for ( const char* ptr = start; ptr < end; ptr++ )
+    {
+        std::fputc(*ptr, stdout);
+        if ( ptr[0] == '%' and ptr + 1 < end and ptr[1] == '%' )
+        {
+            ptr++;
+        }
+    }
+}
+
+template<typename T>
+static void formatValue(char* text, int size, const char* spec, const int* stars, int num_stars, T value)
+{
+    if ( num_stars == 2 )
+    {
+        std::snprintf(text, size, spec, stars[0], stars[1], value);
+    }
+    else if ( num_stars == 1 )
+    {
+        std::snprintf(text, size, spec, stars[0], value);
+    }
+    else
+    {
+        std::snprintf(text, size, spec, value);
+    }
+}
+
+// Formats one conversion with the arguments it consumes. Returns false if they are missing from the record
+static bool writeConversion(const LogConversion& conversion, Reader& args)
+{
+    char spec[64];
+    int  spec_length = conversion.end - conversion.start;
+    if ( spec_length >= (int)sizeof(spec) )
+    {
+        return false;
+    }
+    std::memcpy(spec, conversion.start, spec_length);
+    spec[spec_length] = '\0';
+
+    // The "*" width and precision always come before the value
+    int stars[2];
+    int num_stars = conversion.num_args - 1;
+    for ( int idx = 0; idx < num_stars; idx++ )
+    {
+        if ( not readValue(args, stars[idx]) )
+        {
+            return false;
+        }
+    }
+
+    char text[1024];
+    switch ( conversion.arg_types[num_stars] )
+    {
+    case LOG_ARG_INT32:
+    {
+        std::int32_t value;
+        if ( not readValue(args, value) )
+        {
+            return false;
+        }
+        formatValue(text, sizeof(text), spec, stars, num_stars, value);
+        break;
+    }
+    case LOG_ARG_INT64:
+    {
+        long long value;
+        if ( not readValue(args, value) )
+        {
+            return false;
+        }
+        formatValue(text, sizeof(text), spec, stars, num_stars, value);
+        break;
+    }
+    case LOG_ARG_DOUBLE:
+    {
+        double value;
+        if ( not readValue(args, value) )
+        {
+            return false;
+        }
+        formatValue(text, sizeof(text), spec, stars, num_stars, value);
+        break;
+    }
+    case LOG_ARG_LONG_DOUBLE:
+    {
+        double value;
+        if ( not readValue(args, value) )
+        {
+            return false;
+        }
+        formatValue(text, sizeof(text), spec, stars, num_stars, static_cast<long double>(value));
+        break;
+    }
+    case LOG_ARG_POINTER:
+    {
+        std::uint64_t value;
+        if ( not readValue(args, value) )
+        {
+            return false;
+        }
+        formatValue(text, sizeof(text), spec, stars, num_stars, reinterpret_cast<void*>(value));
+        break;
+    }
+    case LOG_ARG_WIDE_STRING: // Stored as UTF-8, so printed as a narrow string
+    case LOG_ARG_WIDE_STRING_PRECISION:
+        if ( spec[spec_length - 1] == 'S' )
+        {
+            spec[spec_length - 1] = 's';
+        }
+        else
+        {
+            spec[spec_length - 2] = 's'; // Drops the 'l'
+            spec[spec_length - 1] = '\0';
+        }
+        [[fallthrough]];
+    case LOG_ARG_STRING:
+    case LOG_ARG_STRING_PRECISION:
+    {
+        std::uint16_t length;
+        if ( not readValue(args, length) or args.pos + length > args.size )
+        {
+            return false;
+        }
+        char string[1024];
+        length = length < sizeof(string) ? length : sizeof(string) - 1;
+        std::memcpy(string, args.data + args.pos, length);
+        string[length] = '\0';
+        args.pos += length;
+        formatValue(text, sizeof(text), spec, stars, num_stars, static_cast<const char*>(string));
+        break;
+    }
+    }
+    std::fputs(text, stdout);
+    return true;
+}
+
+static void writeMessage(const char* fmt, std::uint8_t level, std::uint8_t category, std::int64_t time_ns, Reader& args)
+{
+    std::time_t seconds = time_ns / 1000000000;
+    std::tm     local;
+    localtime_r(&seconds, &local);
+    char time_text[16];
+    std::strftime(time_text, sizeof(time_text), "%H:%M:%S", &local);
+    std::printf("%s.%03d [%s] ", time_text, (int)(time_ns / 1000000 % 1000), level <= Logger::LOG_ERROR ? level_strings[level] : "?");
+    if ( category > 0 and category < Logger::CAT_COUNT )
+    {
+        std::printf("%s: ", category_strings[category]);
+    }
+
+    if ( not fmt )
+    {
+        std::printf("<unknown format>\n");
+        return;
+    }
+
+    LogConversion conversion;
+    const char*   next = fmt;
+    bool          conversion_failed = false;
+    while ( not conversion_failed and logNextConversion(next, conversion) )
+    {
+        writeLiteral(next, conversion.start);
+        conversion_failed = not writeConversion(conversion, args);
+        next = conversion.end;
+    }
+    if ( conversion_failed )
+    {
+        std::printf("<truncated>");
+    }
+    if ( not conversion_failed )
+    {
+        writeLiteral(next, next + std::strlen(next));
+    }
+    std::fputc('\n', stdout);
+}
+
+int main(int argc, char* argv[])
+{
+    if ( argc != 2 )
+    {
+        std::fprintf(stderr, "Usage: %s <binary log>\n", argv[0]);
+        return 1;
+    }
+    std::setlocale(LC_CTYPE, ""); // "%lc" prints wide characters in the encoding of the terminal
+
+    long  size = 0;
+    char* data = readFile(argv[1], size);
+    if ( not data )
+    {
+        std::fprintf(stderr, "Could not read %s\n", argv[1]);
+        return 1;
+    }
+
+    Reader        reader {data, size, 0};
+    char          magic[sizeof(LOG_BINARY_MAGIC)];
+    std::uint32_t version = 0;
+    if ( not readValue(reader, magic) or std::memcmp(magic, LOG_BINARY_MAGIC, sizeof(magic)) != 0 or
+         not readValue(reader, version) or version != LOG_BINARY_VERSION )
+    {
+        std::fprintf(stderr, "%s is not a binary log of version %u\n", argv[1], LOG_BINARY_VERSION);
+        return 1;
+    }
+    long first_record = reader.pos;
+
+    static char* formats[MAX_FORMATS];
+    for ( int pass = 0; pass < 2; pass++ )
+    {
+        reader.pos = first_record;
+        std::uint8_t type;
+        while ( readValue(reader, type) )
+        {
+            if ( type == LOG_RECORD_FORMAT )
+            {
+                std::uint16_t id, length;
+                if ( not readValue(reader, id) or not readValue(reader, length) or reader.pos + length > reader.size )
+                {
+                    break;
+                }
+                if ( pass == 0 and not formats[id] )
+                {
+                    formats[id] = strndup(reader.data + reader.pos, length);
+                }
+                reader.pos += length;
+            }
+            else if ( type == LOG_RECORD_MESSAGE )
+            {
+                std::uint8_t  level, category;
+                std::uint16_t id, args_size;
+                std::int64_t  time_ns;
+                if ( not readValue(reader, level) or not readValue(reader, category) or not readValue(reader, id) or
+                     not readValue(reader, time_ns) or not readValue(reader, args_size) or
+                     reader.pos + args_size > reader.size )
+                {
+                    break;
+                }
+                if ( pass == 1 )
+                {
+                    Reader args {reader.data + reader.pos, args_size, 0};
+                    writeMessage(formats[id], level, category, time_ns, args);
+                }
+                reader.pos += args_size;
+            }
+            else if ( type == LOG_RECORD_DROPPED )
+            {
+                std::uint64_t count;
+                if ( not readValue(reader, count) )
+                {
+                    break;
+                }
+                if ( pass == 1 )
+                {
+                    std::printf("Log buffer was full. %lu messages were dropped\n", (unsigned long)count);
+                }
+            }
+            else
+            {
+                std::fprintf(stderr, "Unknown record type %u at offset %ld\n", type, reader.pos - 1);
+                break;
+            }
+        }
+    }
+    if ( reader.pos < reader.size )
+    {
+        std::fprintf(stderr, "The log ends with an incomplete record\n");
+    }
+
+    for ( char* format : formats )
+    {
+        std::free(format);
+    }
+    std::free(data);
+    return 0;
+}